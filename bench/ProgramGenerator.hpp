@@ -0,0 +1,218 @@
+#ifndef HH_PROGRAM_GENERATOR_INCLUDE_GUARD
+#define HH_PROGRAM_GENERATOR_INCLUDE_GUARD 1
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <random>
+#include <string>
+
+namespace WhileParser
+{
+    // Shape of the programs produced by ProgramGenerator
+    struct GeneratorOptions
+    {
+        std::uint64_t seed = 1;
+
+        std::size_t statements = 1000;          // top level statements, i.e. width of the RootNode
+        std::size_t max_depth = 3;              // maximum nesting of if/while statements
+        double nesting_probability = 0.3;       // chance of an if/while where the depth allows it
+        double while_probability = 0.5;         // chance that a nested statement is a while instead of an if
+        double skip_probability = 0.1;          // chance of a skip instead of an assignment
+
+        std::size_t expression_operands = 4;    // operands of each arithmetic chain
+        double parenthesis_probability = 0.1;   // chance that an operand is a parenthesized chain
+        std::size_t predicate_terms = 2;        // terms of each boolean chain
+        double not_probability = 0.1;           // chance of a not in front of a term
+        double constant_probability = 0.1;      // chance that a term is true/false instead of a comparison
+
+        // relative weights of the operators
+        unsigned plus_weight = 4;
+        unsigned minus_weight = 2;
+        unsigned times_weight = 2;
+        unsigned divide_weight = 1;
+        unsigned and_weight = 1;
+        unsigned or_weight = 1;
+    };
+
+    struct GeneratedProgram
+    {
+        std::string source;
+        std::size_t tokens = 0; // END_OF_FILE included
+        std::size_t nodes = 0;  // AST nodes built by the parser, RootNode included
+    };
+
+    // Seeded generator of random, syntactically valid WHILE programs.
+    // The same options always give the same program.
+    class ProgramGenerator
+    {
+    public:
+        ProgramGenerator(const GeneratorOptions &options) : m_options(options), m_random(options.seed) {}
+
+        GeneratedProgram generate()
+        {
+            m_program = GeneratedProgram{};
+            m_program.nodes = 1;
+            for (std::size_t idx = 0; idx < m_options.statements; ++idx)
+            {
+                statement(0);
+                m_program.source += '\n';
+            }
+            m_program.tokens += 1;
+            return std::move(m_program);
+        }
+
+    private:
+        void emit(const char *text)
+        {
+            m_program.source += text;
+            m_program.source += ' ';
+            ++m_program.tokens;
+        }
+
+        void emit(const std::string &text)
+        {
+            emit(text.c_str());
+        }
+
+        bool chance(double probability)
+        {
+            return std::uniform_real_distribution<double>(0.0, 1.0)(m_random) < probability;
+        }
+
+        std::size_t pick(std::size_t count)
+        {
+            return std::uniform_int_distribution<std::size_t>(0, count - 1)(m_random);
+        }
+
+        std::string identifier()
+        {
+            static const char *names[] = {"x", "y", "counter", "total_sum", "i", "j", "accumulator_value", "n1"};
+            return names[pick(sizeof(names) / sizeof(names[0]))];
+        }
+
+        void statement(std::size_t depth)
+        {
+            ++m_program.nodes;
+            if (depth < m_options.max_depth && chance(m_options.nesting_probability))
+            {
+                if (chance(m_options.while_probability))
+                {
+                    emit("while");
+                    predicate();
+                    emit("do");
+                    statement(depth + 1);
+                    emit("endwhile");
+                }
+                else
+                {
+                    emit("if");
+                    predicate();
+                    emit("then");
+                    statement(depth + 1);
+                    emit("else");
+                    statement(depth + 1);
+                    emit("endif");
+                }
+                return;
+            }
+
+            if (chance(m_options.skip_probability))
+            {
+                emit("skip");
+                return;
+            }
+
+            emit(identifier());
+            emit(":=");
+            expression(true);
+            emit(";");
+        }
+
+        // in a comparison the first operand can't be parenthesized, a ( there opens a predicate
+        void expression(bool allow_parenthesis)
+        {
+            const unsigned weights[] = {m_options.plus_weight, m_options.minus_weight, m_options.times_weight, m_options.divide_weight};
+            const char *operators[] = {"+", "-", "*", "/"};
+            std::discrete_distribution<std::size_t> op(std::begin(weights), std::end(weights));
+
+            std::size_t operands = std::max<std::size_t>(m_options.expression_operands, 1);
+            for (std::size_t idx = 0; idx < operands; ++idx)
+            {
+                if (idx != 0)
+                {
+                    emit(operators[op(m_random)]);
+                    ++m_program.nodes; // MathExpressionNode
+                }
+                operand(allow_parenthesis || idx != 0);
+            }
+        }
+
+        void operand(bool allow_parenthesis)
+        {
+            if (allow_parenthesis && chance(m_options.parenthesis_probability))
+            {
+                emit("(");
+                // nested chains are short, so they don't blow up the size of the program
+                std::size_t operands = m_options.expression_operands;
+                m_options.expression_operands = std::min<std::size_t>(operands, 3);
+                expression(true);
+                m_options.expression_operands = operands;
+                emit(")");
+                return;
+            }
+
+            ++m_program.nodes;
+            if (chance(0.5))
+                emit(identifier());
+            else
+                emit(std::to_string(std::uniform_int_distribution<int>(0, 100000)(m_random)));
+        }
+
+        void predicate()
+        {
+            const unsigned weights[] = {m_options.and_weight, m_options.or_weight};
+            const char *operators[] = {"and", "or"};
+            std::discrete_distribution<std::size_t> op(std::begin(weights), std::end(weights));
+
+            std::size_t terms = std::max<std::size_t>(m_options.predicate_terms, 1);
+            for (std::size_t idx = 0; idx < terms; ++idx)
+            {
+                if (idx != 0)
+                {
+                    emit(operators[op(m_random)]);
+                    ++m_program.nodes; // BooleanPredicateNode
+                }
+                term();
+            }
+        }
+
+        void term()
+        {
+            if (chance(m_options.not_probability))
+            {
+                emit("not");
+                ++m_program.nodes;
+            }
+
+            ++m_program.nodes;
+            if (chance(m_options.constant_probability))
+            {
+                emit(chance(0.5) ? "true" : "false");
+                return;
+            }
+
+            const char *relations[] = {"<", "<=", "=", ">", ">="};
+            expression(false);
+            emit(relations[pick(5)]);
+            expression(true);
+        }
+
+        GeneratorOptions m_options;
+        std::mt19937_64 m_random;
+        GeneratedProgram m_program;
+    };
+}
+
+#endif
@@ -0,0 +1,567 @@
+#include <benchmark/benchmark.h>
+#include <charconv>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <memory>
+#include <sstream>
+#include <streambuf>
+#include <string>
+
+#include "../include/Lexer.hpp"
+#include "../include/DfaLexer.hpp"
+#include "../include/Parser.hpp"
+#include "../include/FlatAST.hpp"
+#include "../include/IncrementalParser.hpp"
+#include "../include/ParallelParser.hpp"
+#include "../include/ParseCache.hpp"
+#include "../include/ParserPool.hpp"
+#include "./ProgramGenerator.hpp"
+
+// Counts every heap allocation and its size, to compare the memory of the representations
+static std::size_t g_allocations = 0;
+static std::size_t g_allocated_bytes = 0;
+
+void *operator new(std::size_t size)
+{
+    ++g_allocations;
+    g_allocated_bytes += size;
+    if (void *memory = std::malloc(size ? size : 1))
+        return memory;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void *memory, std::size_t) noexcept
+{
+    std::free(memory);
+}
+
+namespace
+{
+    struct Shape
+    {
+        const char *name;
+        WhileParser::GeneratorOptions options;
+    };
+
+    // wide: many flat statements, deep: long towers of nested whiles, chains: long arithmetic and boolean chains
+    const Shape SHAPES[] = {
+        {"wide", [] { WhileParser::GeneratorOptions o; o.statements = 20000; o.max_depth = 0; return o; }()},
+        {"deep", [] { WhileParser::GeneratorOptions o; o.statements = 200; o.max_depth = 200; o.nesting_probability = 0.99; o.while_probability = 1.0; return o; }()},
+        {"chains", [] { WhileParser::GeneratorOptions o; o.statements = 100; o.max_depth = 1; o.expression_operands = 100; o.predicate_terms = 20; return o; }()},
+        {"mixed", [] { WhileParser::GeneratorOptions o; o.statements = 5000; o.max_depth = 4; return o; }()},
+    };
+    constexpr int SHAPE_COUNT = sizeof(SHAPES) / sizeof(SHAPES[0]);
+
+    // programs are generated once per shape and shared by all the benchmarks
+    const WhileParser::GeneratedProgram &program(benchmark::State &state)
+    {
+        static WhileParser::GeneratedProgram programs[SHAPE_COUNT];
+        int idx = static_cast<int>(state.range(0));
+        if (programs[idx].source.empty())
+            programs[idx] = WhileParser::ProgramGenerator(SHAPES[idx].options).generate();
+        state.SetLabel(SHAPES[idx].name);
+        return programs[idx];
+    }
+
+    std::shared_ptr<const WhileParser::SourceBuffer> source(const WhileParser::GeneratedProgram &program)
+    {
+        return WhileParser::SourceBuffer::fromString(program.source);
+    }
+
+    void reportRates(benchmark::State &state, const WhileParser::GeneratedProgram &program)
+    {
+        auto iterations = static_cast<double>(state.iterations());
+        state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * program.source.size()));
+        state.counters["tokens/s"] = benchmark::Counter(iterations * program.tokens, benchmark::Counter::kIsRate);
+        state.counters["nodes/s"] = benchmark::Counter(iterations * program.nodes, benchmark::Counter::kIsRate);
+    }
+
+    // discards everything printNode writes on std::cout
+    class NullBuffer : public std::streambuf
+    {
+    protected:
+        int_type overflow(int_type c) override
+        {
+            return c;
+        }
+
+        std::streamsize xsputn(const char *, std::streamsize count) override
+        {
+            return count;
+        }
+    };
+}
+
+static void BM_LexerNextToken(benchmark::State &state)
+{
+    const auto &generated = program(state);
+    auto buffer = source(generated);
+    for (auto _ : state)
+    {
+        WhileParser::Lexer lexer(buffer, true, true);
+        while (lexer.nextToken().getType() != WhileParser::TokenType::END_OF_FILE)
+            ;
+    }
+    reportRates(state, generated);
+}
+BENCHMARK(BM_LexerNextToken)->DenseRange(0, SHAPE_COUNT - 1)->Unit(benchmark::kMillisecond);
+
+static void BM_LexerStreamNextToken(benchmark::State &state)
+{
+    const auto &generated = program(state);
+    for (auto _ : state)
+    {
+        WhileParser::Lexer lexer(std::make_unique<std::istringstream>(generated.source), true, true);
+        while (lexer.nextToken().getType() != WhileParser::TokenType::END_OF_FILE)
+            ;
+    }
+    reportRates(state, generated);
+}
+BENCHMARK(BM_LexerStreamNextToken)->DenseRange(0, SHAPE_COUNT - 1)->Unit(benchmark::kMillisecond);
+
+static void BM_DfaLexerNextToken(benchmark::State &state)
+{
+    const auto &generated = program(state);
+    auto buffer = source(generated);
+    for (auto _ : state)
+    {
+        WhileParser::DfaLexer lexer(buffer, true, true);
+        while (lexer.nextToken().getType() != WhileParser::TokenType::END_OF_FILE)
+            ;
+    }
+    reportRates(state, generated);
+}
+BENCHMARK(BM_DfaLexerNextToken)->DenseRange(0, SHAPE_COUNT - 1)->Unit(benchmark::kMillisecond);
+
+static void BM_LexerTokenizeAll(benchmark::State &state)
+{
+    const auto &generated = program(state);
+    auto buffer = source(generated);
+    for (auto _ : state)
+        benchmark::DoNotOptimize(WhileParser::Lexer(buffer, true, true).tokenizeAll());
+    reportRates(state, generated);
+}
+BENCHMARK(BM_LexerTokenizeAll)->DenseRange(0, SHAPE_COUNT - 1)->Unit(benchmark::kMillisecond);
+
+// Conversion of the number lexemes, done once by the lexer: the 8 digits at a time routine against from_chars
+static std::vector<std::string> numberLexemes()
+{
+    std::vector<std::string> lexemes;
+    std::uint64_t value = 1;
+    for (int idx = 0; idx < 1024; ++idx)
+    {
+        value = value * 6364136223846793005ull + 1442695040888963407ull;
+        lexemes.push_back(std::to_string(value >> (idx % 60)));
+    }
+    return lexemes;
+}
+
+static void BM_ParseNumber(benchmark::State &state)
+{
+    auto lexemes = numberLexemes();
+    for (auto _ : state)
+        for (const auto &lexeme : lexemes)
+            benchmark::DoNotOptimize(WhileParser::parseNumber(lexeme.data(), lexeme.data() + lexeme.size()));
+    state.SetItemsProcessed(state.iterations() * lexemes.size());
+}
+BENCHMARK(BM_ParseNumber);
+
+static void BM_FromCharsNumber(benchmark::State &state)
+{
+    auto lexemes = numberLexemes();
+    for (auto _ : state)
+        for (const auto &lexeme : lexemes)
+        {
+            std::int64_t value = 0;
+            benchmark::DoNotOptimize(std::from_chars(lexeme.data(), lexeme.data() + lexeme.size(), value));
+            benchmark::DoNotOptimize(value);
+        }
+    state.SetItemsProcessed(state.iterations() * lexemes.size());
+}
+BENCHMARK(BM_FromCharsNumber);
+
+static void BM_ParserParse(benchmark::State &state)
+{
+    const auto &generated = program(state);
+    for (auto _ : state)
+    {
+        WhileParser::Parser parser(std::make_unique<std::istringstream>(generated.source));
+        benchmark::DoNotOptimize(parser.parse());
+    }
+    reportRates(state, generated);
+}
+BENCHMARK(BM_ParserParse)->DenseRange(0, SHAPE_COUNT - 1)->Unit(benchmark::kMillisecond);
+
+static void BM_ParserParseTokenStream(benchmark::State &state)
+{
+    const auto &generated = program(state);
+    auto tokens = WhileParser::Lexer(source(generated), true, true).tokenizeAll();
+    for (auto _ : state)
+    {
+        WhileParser::Parser parser(tokens);
+        benchmark::DoNotOptimize(parser.parse());
+    }
+    reportRates(state, generated);
+}
+BENCHMARK(BM_ParserParseTokenStream)->DenseRange(0, SHAPE_COUNT - 1)->Unit(benchmark::kMillisecond);
+
+// errors are collected instead of thrown: on a valid program it must cost as much as parse()
+static void BM_ParserParseWithDiagnostics(benchmark::State &state)
+{
+    const auto &generated = program(state);
+    auto tokens = WhileParser::Lexer(source(generated), true, true).tokenizeAll();
+    for (auto _ : state)
+    {
+        WhileParser::Parser parser(tokens);
+        benchmark::DoNotOptimize(parser.parseWithDiagnostics());
+    }
+    reportRates(state, generated);
+}
+BENCHMARK(BM_ParserParseWithDiagnostics)->DenseRange(0, SHAPE_COUNT - 1)->Unit(benchmark::kMillisecond);
+
+// same tokens, walked by the explicit stack instead of the call stack
+static void BM_ParserParseExplicitStack(benchmark::State &state)
+{
+    const auto &generated = program(state);
+    auto tokens = WhileParser::Lexer(source(generated), true, true).tokenizeAll();
+    for (auto _ : state)
+    {
+        WhileParser::Parser parser(tokens);
+        parser.setParseMode(WhileParser::ParseMode::EXPLICIT_STACK);
+        benchmark::DoNotOptimize(parser.parse());
+    }
+    reportRates(state, generated);
+}
+BENCHMARK(BM_ParserParseExplicitStack)->DenseRange(0, SHAPE_COUNT - 1)->Unit(benchmark::kMillisecond);
+
+// each statement is destroyed as soon as it's parsed, instead of the whole tree at the end
+static void BM_ParserParseEach(benchmark::State &state)
+{
+    const auto &generated = program(state);
+    for (auto _ : state)
+    {
+        WhileParser::Parser parser(std::make_unique<std::istringstream>(generated.source));
+        benchmark::DoNotOptimize(parser.parseEach([](const WhileParser::StatementNode &statement)
+                                                  { benchmark::DoNotOptimize(&statement); }));
+    }
+    reportRates(state, generated);
+}
+BENCHMARK(BM_ParserParseEach)->DenseRange(0, SHAPE_COUNT - 1)->Unit(benchmark::kMillisecond);
+
+// top level statements parsed on range(1) threads, to compare with BM_ParserParseTokenStream
+static void BM_ParallelParse(benchmark::State &state)
+{
+    const auto &generated = program(state);
+    auto tokens = WhileParser::Lexer(source(generated), true, true).tokenizeAll();
+    WhileParser::ParallelParser parser(tokens, static_cast<unsigned>(state.range(1)));
+    for (auto _ : state)
+        benchmark::DoNotOptimize(parser.parse());
+    reportRates(state, generated);
+}
+BENCHMARK(BM_ParallelParse)->ArgsProduct({benchmark::CreateDenseRange(0, SHAPE_COUNT - 1, 1), {1, 2, 4, 8}})->Unit(benchmark::kMillisecond)->UseRealTime();
+
+// many tiny programs, with a new parser each or with one parser reset on each of them
+static const char *const SNIPPETS[] = {"x := 1;", "y := x + 2 * z;", "if x < y then skip else x := y; endif", "while x > 0 do x := x - 1; endwhile"};
+
+static void BM_ParserNewPerSnippet(benchmark::State &state)
+{
+    std::size_t idx = 0;
+    for (auto _ : state)
+    {
+        WhileParser::Parser parser(std::make_unique<std::istringstream>(SNIPPETS[idx++ % 4]));
+        benchmark::DoNotOptimize(parser.parse());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ParserNewPerSnippet);
+
+static void BM_ParserResetPerSnippet(benchmark::State &state)
+{
+    WhileParser::ParserPool pool;
+    std::size_t idx = 0;
+    for (auto _ : state)
+    {
+        auto parser = pool.acquire();
+        parser->reset(std::string_view(SNIPPETS[idx++ % 4]));
+        benchmark::DoNotOptimize(parser->parse());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ParserResetPerSnippet);
+
+// a keystroke in the middle of the program: a digit typed over another one, compared with BM_ParserParseWithDiagnostics
+static void BM_IncrementalEdit(benchmark::State &state)
+{
+    const auto &generated = program(state);
+    WhileParser::IncrementalParser incremental(generated.source);
+    std::size_t offset = generated.source.find_first_of("0123456789", generated.source.size() / 2);
+    char digit = '0';
+    for (auto _ : state)
+    {
+        digit = digit == '9' ? '0' : digit + 1;
+        incremental.edit(offset, 1, std::string_view(&digit, 1));
+        benchmark::DoNotOptimize(&incremental.getTree());
+    }
+    state.counters["reparsed bytes"] = static_cast<double>(incremental.getReparsedBytes());
+}
+BENCHMARK(BM_IncrementalEdit)->DenseRange(0, SHAPE_COUNT - 1)->Unit(benchmark::kMicrosecond);
+
+// parse and destroy: one allocation per node, and a teardown that goes through every node
+static void BM_ParserParseAndDestroy(benchmark::State &state)
+{
+    const auto &generated = program(state);
+    auto tokens = WhileParser::Lexer(source(generated), true, true).tokenizeAll();
+    std::size_t before = g_allocations;
+    for (auto _ : state)
+    {
+        WhileParser::Parser parser(tokens);
+        auto root = parser.parse();
+        benchmark::DoNotOptimize(root.get());
+    }
+    state.counters["allocations"] = benchmark::Counter(static_cast<double>(g_allocations - before), benchmark::Counter::kAvgIterations);
+    reportRates(state, generated);
+}
+BENCHMARK(BM_ParserParseAndDestroy)->DenseRange(0, SHAPE_COUNT - 1)->Unit(benchmark::kMillisecond);
+
+// parse and destroy in an arena: a few blocks, released at once
+static void BM_ParserParseInArenaAndDestroy(benchmark::State &state)
+{
+    const auto &generated = program(state);
+    auto tokens = WhileParser::Lexer(source(generated), true, true).tokenizeAll();
+    std::size_t before = g_allocations;
+    std::size_t arena_bytes = 0;
+    for (auto _ : state)
+    {
+        WhileParser::Parser parser(tokens);
+        auto tree = parser.parseInArena();
+        arena_bytes = tree.getArena().getReservedBytes();
+        benchmark::DoNotOptimize(tree.get());
+    }
+    state.counters["arena_bytes"] = static_cast<double>(arena_bytes);
+    state.counters["allocations"] = benchmark::Counter(static_cast<double>(g_allocations - before), benchmark::Counter::kAvgIterations);
+    reportRates(state, generated);
+}
+BENCHMARK(BM_ParserParseInArenaAndDestroy)->DenseRange(0, SHAPE_COUNT - 1)->Unit(benchmark::kMillisecond);
+
+// hash consing: identical expressions and predicates are built once
+static void BM_ParserParseHashConsed(benchmark::State &state)
+{
+    const auto &generated = program(state);
+    auto tokens = WhileParser::Lexer(source(generated), true, true).tokenizeAll();
+    std::size_t arena_bytes = 0;
+    for (auto _ : state)
+    {
+        WhileParser::Parser parser(tokens);
+        auto tree = parser.parseInArena(true);
+        arena_bytes = tree.getArena().getReservedBytes();
+        benchmark::DoNotOptimize(tree.get());
+    }
+    state.counters["arena_bytes"] = static_cast<double>(arena_bytes);
+    reportRates(state, generated);
+}
+BENCHMARK(BM_ParserParseHashConsed)->DenseRange(0, SHAPE_COUNT - 1)->Unit(benchmark::kMillisecond);
+
+static void BM_PrintNode(benchmark::State &state)
+{
+    const auto &generated = program(state);
+    auto root = WhileParser::Parser(std::make_unique<std::istringstream>(generated.source)).parse();
+
+    NullBuffer null_buffer;
+    std::streambuf *cout_buffer = std::cout.rdbuf(&null_buffer);
+    for (auto _ : state)
+        root->printNode();
+    std::cout.rdbuf(cout_buffer);
+
+    reportRates(state, generated);
+}
+BENCHMARK(BM_PrintNode)->DenseRange(0, SHAPE_COUNT - 1)->Unit(benchmark::kMillisecond);
+
+// the recursive, dynamic_cast based comparison that isEqual used to do, as a baseline
+static bool legacyIsEqual(const WhileParser::ASTNode *left, const WhileParser::ASTNode *right)
+{
+    using namespace WhileParser;
+    if (auto l = dynamic_cast<const RootNode *>(left))
+    {
+        auto r = dynamic_cast<const RootNode *>(right);
+        if (r == nullptr)
+            return false;
+        bool equal = true;
+        for (std::size_t idx = 0; idx < l->getChildren().size(); ++idx)
+            equal = equal && legacyIsEqual(l->getChildren()[idx].get(), r->getChildren().at(idx).get());
+        return equal;
+    }
+    if (auto l = dynamic_cast<const MathExpressionNode *>(left))
+    {
+        auto r = dynamic_cast<const MathExpressionNode *>(right);
+        return r && l->getOperation() == r->getOperation() && legacyIsEqual(l->getLeftExpression(), r->getLeftExpression()) &&
+               legacyIsEqual(l->getRightExpression(), r->getRightExpression());
+    }
+    if (auto l = dynamic_cast<const NotPredicateNode *>(left))
+    {
+        auto r = dynamic_cast<const NotPredicateNode *>(right);
+        return r && legacyIsEqual(l->getPredicate(), r->getPredicate());
+    }
+    if (auto l = dynamic_cast<const BooleanPredicateNode *>(left))
+    {
+        auto r = dynamic_cast<const BooleanPredicateNode *>(right);
+        return r && l->getOperation() == r->getOperation() && legacyIsEqual(l->getLeftPredicate(), r->getLeftPredicate()) &&
+               legacyIsEqual(l->getRightPredicate(), r->getRightPredicate());
+    }
+    if (auto l = dynamic_cast<const RelationalPredicateNode *>(left))
+    {
+        auto r = dynamic_cast<const RelationalPredicateNode *>(right);
+        return r && l->getOperation() == r->getOperation() && legacyIsEqual(l->getLeftExpression(), r->getLeftExpression()) &&
+               legacyIsEqual(l->getRightExpression(), r->getRightExpression());
+    }
+    if (auto l = dynamic_cast<const NumberLiteralNode *>(left))
+    {
+        auto r = dynamic_cast<const NumberLiteralNode *>(right);
+        return r && l->getValue() == r->getValue() && l->getDigits() == r->getDigits();
+    }
+    if (auto l = dynamic_cast<const VariableRefNode *>(left))
+    {
+        auto r = dynamic_cast<const VariableRefNode *>(right);
+        return r && l->getName() == r->getName();
+    }
+    if (auto l = dynamic_cast<const PredicateNode *>(left))
+    {
+        auto r = dynamic_cast<const PredicateNode *>(right);
+        return r && l->getTerminalPredicate() == r->getTerminalPredicate();
+    }
+    if (auto l = dynamic_cast<const AssignmentNode *>(left))
+    {
+        auto r = dynamic_cast<const AssignmentNode *>(right);
+        return r && l->getVariableName() == r->getVariableName() && legacyIsEqual(l->getExpression(), r->getExpression());
+    }
+    if (auto l = dynamic_cast<const IfNode *>(left))
+    {
+        auto r = dynamic_cast<const IfNode *>(right);
+        return r && legacyIsEqual(l->getCondition(), r->getCondition()) && legacyIsEqual(l->getThenBranch(), r->getThenBranch()) &&
+               legacyIsEqual(l->getElseBranch(), r->getElseBranch());
+    }
+    if (auto l = dynamic_cast<const WhileNode *>(left))
+    {
+        auto r = dynamic_cast<const WhileNode *>(right);
+        return r && legacyIsEqual(l->getCondition(), r->getCondition()) && legacyIsEqual(l->getStatement(), r->getStatement());
+    }
+    return dynamic_cast<const SkipNode *>(right) != nullptr;
+}
+
+static void BM_LegacyIsEqual(benchmark::State &state)
+{
+    const auto &generated = program(state);
+    auto left = WhileParser::Parser(std::make_unique<std::istringstream>(generated.source)).parse();
+    auto right = WhileParser::Parser(std::make_unique<std::istringstream>(generated.source)).parse();
+    for (auto _ : state)
+        benchmark::DoNotOptimize(legacyIsEqual(left.get(), right.get()));
+    reportRates(state, generated);
+}
+BENCHMARK(BM_LegacyIsEqual)->DenseRange(0, SHAPE_COUNT - 1)->Unit(benchmark::kMillisecond);
+
+static void BM_IsEqual(benchmark::State &state)
+{
+    const auto &generated = program(state);
+    auto left = WhileParser::Parser(std::make_unique<std::istringstream>(generated.source)).parse();
+    auto right = WhileParser::Parser(std::make_unique<std::istringstream>(generated.source)).parse();
+    for (auto _ : state)
+        benchmark::DoNotOptimize(left->isEqual(right.get()));
+    reportRates(state, generated);
+}
+BENCHMARK(BM_IsEqual)->DenseRange(0, SHAPE_COUNT - 1)->Unit(benchmark::kMillisecond);
+
+// tree to flat conversion, with the memory taken by the two representations
+static void BM_FlatFromTree(benchmark::State &state)
+{
+    const auto &generated = program(state);
+    std::size_t before = g_allocated_bytes;
+    auto root = WhileParser::Parser(std::make_unique<std::istringstream>(generated.source)).parse();
+    std::size_t tree_bytes = g_allocated_bytes - before;
+
+    std::size_t flat_bytes = 0;
+    for (auto _ : state)
+    {
+        auto flat = WhileParser::FlatAST::fromTree(*root);
+        flat_bytes = flat.memoryUsage();
+        benchmark::DoNotOptimize(flat_bytes);
+    }
+    // the tree bytes include the lexer buffers, that are small next to the nodes
+    state.counters["tree_bytes"] = static_cast<double>(tree_bytes);
+    state.counters["flat_bytes"] = static_cast<double>(flat_bytes);
+    reportRates(state, generated);
+}
+BENCHMARK(BM_FlatFromTree)->DenseRange(0, SHAPE_COUNT - 1)->Unit(benchmark::kMillisecond);
+
+static void BM_FlatIsEqual(benchmark::State &state)
+{
+    const auto &generated = program(state);
+    auto root = WhileParser::Parser(std::make_unique<std::istringstream>(generated.source)).parse();
+    auto left = WhileParser::FlatAST::fromTree(*root);
+    auto right = WhileParser::FlatAST::fromTree(*root);
+    for (auto _ : state)
+        benchmark::DoNotOptimize(left.isEqual(right));
+    reportRates(state, generated);
+}
+BENCHMARK(BM_FlatIsEqual)->DenseRange(0, SHAPE_COUNT - 1)->Unit(benchmark::kMillisecond);
+
+// a full pass that reads every node: the texts of the leaves
+static void BM_FlatTextPass(benchmark::State &state)
+{
+    const auto &generated = program(state);
+    auto root = WhileParser::Parser(std::make_unique<std::istringstream>(generated.source)).parse();
+    auto flat = WhileParser::FlatAST::fromTree(*root);
+    for (auto _ : state)
+    {
+        std::size_t length = 0;
+        for (WhileParser::FlatAST::NodeIndex idx = 0; idx < flat.size(); ++idx)
+            length += flat.getText(idx).size();
+        benchmark::DoNotOptimize(length);
+    }
+    reportRates(state, generated);
+}
+BENCHMARK(BM_FlatTextPass)->DenseRange(0, SHAPE_COUNT - 1)->Unit(benchmark::kMillisecond);
+
+// loads a saved program and reads every node, to compare with lexing and parsing the source
+static void BM_FlatLoad(benchmark::State &state)
+{
+    const auto &generated = program(state);
+    auto root = WhileParser::Parser(std::make_unique<std::istringstream>(generated.source)).parse();
+    std::string path = (std::filesystem::temp_directory_path() / "while_parser_bench.wast").string();
+    WhileParser::FlatAST::fromTree(*root).save(path);
+    for (auto _ : state)
+    {
+        auto flat = WhileParser::FlatAST::load(path);
+        std::size_t length = 0;
+        for (WhileParser::FlatAST::NodeIndex idx = 0; idx < flat.size(); ++idx)
+            length += flat.getText(idx).size();
+        benchmark::DoNotOptimize(length);
+    }
+    std::filesystem::remove(path);
+    reportRates(state, generated);
+}
+BENCHMARK(BM_FlatLoad)->DenseRange(0, SHAPE_COUNT - 1)->Unit(benchmark::kMillisecond);
+
+// a hit of the parse cache: hashing the source and mapping its entry, without building the tree
+static void BM_ParseCacheHit(benchmark::State &state)
+{
+    const auto &generated = program(state);
+    std::filesystem::path directory = std::filesystem::temp_directory_path() / "while_parser_bench_cache";
+    std::string path = (directory / "program.wh").string();
+    std::filesystem::create_directories(directory);
+    std::ofstream(path) << generated.source;
+
+    WhileParser::ParseCache cache((directory / "cache").string());
+    cache.parse(path);
+    for (auto _ : state)
+        benchmark::DoNotOptimize(cache.parseFlat(path).size());
+    std::filesystem::remove_all(directory);
+    reportRates(state, generated);
+}
+BENCHMARK(BM_ParseCacheHit)->DenseRange(0, SHAPE_COUNT - 1)->Unit(benchmark::kMillisecond);
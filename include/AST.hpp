@@ -6,158 +6,389 @@
 #include <algorithm>
 #include <vector>
 #include <string>
+#include <string_view>
 #include <typeinfo>
+#include <cstdint>
+#include <functional>
+#include <new>
+
+#include "./Arena.hpp"
+#include "./Keywords.hpp"
+#include "./Scanner.hpp"
+#include "./SymbolTable.hpp"
+#include "./TokenType.hpp"
 
 namespace WhileParser
 {
+    // Concrete kinds of AST nodes
+    enum class NodeKind : std::uint8_t
+    {
+        ROOT,
+        NUMBER_LITERAL,
+        VARIABLE_REF,
+        PREDICATE,
+        ASSIGNMENT,
+        IF,
+        SKIP,
+        WHILE,
+        MATH_EXPRESSION,
+        NOT_PREDICATE,
+        BOOLEAN_PREDICATE,
+        RELATIONAL_PREDICATE
+    };
+
+    class ASTNode;
+    class IncrementalParser;
+
+    // Structural equality of two subtrees. It walks them with an explicit stack, so it works
+    // at any depth, and stops at the first difference. Two null nodes are equal.
+    bool isStructurallyEqual(const ASTNode *left, const ASTNode *right);
+
+    // Opcode of an operator or constant from its spelling ("+", "and", "true", ...), UNKNOWN for
+    // the empty one. It throws a std::invalid_argument for anything else
+    TokenType operatorOf(std::string_view spelling);
+
     class ASTNode
     {
     public:
-        inline virtual void printNode(int indent = 0) const = 0;
-        inline virtual bool isEqual(ASTNode *other) const = 0;
-        inline void printIndentation(const std::string &print_string, int indent) const
-        {
-            for (int i = 0; i < indent; ++i)
-            {
-                if (i == indent - 1)
-                    std::cout << "|-- ";
-                else
-                    std::cout << "|   ";
-            }
-            std::cout << print_string << std::endl;
-        }
-        virtual ~ASTNode() {}
+        inline NodeKind getKind() const
+        {
+            return m_kind;
+        }
+
+        // structural hash of the subtree, computed bottom-up when the node is built:
+        // equal subtrees have equal hashes
+        inline std::uint64_t getHash() const
+        {
+            return m_hash;
+        }
+
+        // prints the subtree as an indented outline. Like isEqual it walks the tree with an explicit
+        // stack, so it works at any depth
+        void printNode(std::ostream &out, int indent = 0) const;
+
+        inline void printNode(int indent = 0) const
+        {
+            printNode(std::cout, indent);
+        }
+
+        inline bool isEqual(const ASTNode *other) const
+        {
+            return isStructurallyEqual(this, other);
+        }
+
+        // nodes are built in the active arena, if any (see Parser::parseInArena)
+        static inline void *operator new(std::size_t size)
+        {
+            return Arena::allocateNode(size);
+        }
+
+        // nodes of an arena are never destroyed one by one, they go away with the arena.
+        // This is what allows an arena tree to share subtrees (see hash consing in Parser)
+        static inline void operator delete(ASTNode *node, std::destroying_delete_t)
+        {
+            if (node->m_in_arena)
+                return;
+            node->~ASTNode();
+            ::operator delete(node);
+        }
+
+        // used if a constructor throws
+        static inline void operator delete(void *node)
+        {
+            Arena::deallocateNode(node);
+        }
+
+        // destroys the children that the destructors of the derived nodes handed over to
+        // destroyLater, one after the other, so deleting a deep tree doesn't recurse
+        virtual ~ASTNode();
+
+    protected:
+        ASTNode(NodeKind kind, std::uint64_t hash) : m_hash(hash), m_kind(kind), m_in_arena(Arena::active() != nullptr) {}
+
+        // called by the destructors of the nodes with children, instead of letting the
+        // unique_ptr members destroy the subtrees recursively
+        static void destroyLater(std::unique_ptr<ASTNode> child);
+
+        static inline std::uint64_t combineHash(std::uint64_t seed, std::uint64_t value)
+        {
+            value ^= value >> 33;
+            value *= 0xff51afd7ed558ccdULL;
+            value ^= value >> 33;
+            return (seed ^ value) * 0x9e3779b97f4a7c15ULL + 0x632be59bd9b4e019ULL;
+        }
+
+        static inline std::uint64_t hashKind(NodeKind kind)
+        {
+            return combineHash(0, static_cast<std::uint64_t>(kind) + 1);
+        }
+
+        static inline std::uint64_t hashText(std::string_view text)
+        {
+            return std::hash<std::string_view>{}(text);
+        }
+
+        // copy of a text the node keeps: in the active arena if there is one, otherwise in owned
+        static inline std::string_view copyText(std::string_view text, std::unique_ptr<char[]> &owned)
+        {
+            if (Arena *arena = Arena::active())
+                return arena->copy(text);
+            owned = std::make_unique<char[]>(text.size());
+            std::copy(text.begin(), text.end(), owned.get());
+            return std::string_view(owned.get(), text.size());
+        }
+
+        static inline std::uint64_t hashChild(const ASTNode *child)
+        {
+            return child ? child->m_hash : 0;
+        }
+
+        inline void setHash(std::uint64_t hash)
+        {
+            m_hash = hash;
+        }
+
+    private:
+        // the kind and the flag are last: the opcodes of the derived nodes go in the padding after them
+        std::uint64_t m_hash;
+        NodeKind m_kind;
+        bool m_in_arena; // allocated in the active arena of its constructor, see operator new
     };
 
     // Meta-node that represents the entrypoint
     class RootNode : public ASTNode
     {
     public:
-        RootNode() : m_children(std::vector<std::unique_ptr<ASTNode>>{}) {}
+        RootNode() : ASTNode(NodeKind::ROOT, hashKind(NodeKind::ROOT)), m_children() {}
+
+        // the children of a tree built in an arena live in the arena too
+        using Children = std::vector<std::unique_ptr<ASTNode>, ArenaAllocator<std::unique_ptr<ASTNode>>>;
 
-        inline bool isEqual(ASTNode *other) const override
+        inline void addNode(std::unique_ptr<ASTNode> node)
         {
-            auto other_root = dynamic_cast<RootNode *>(other);
-            if (other_root == nullptr)
-                return false;
+            setHash(combineHash(getHash(), hashChild(node.get())));
+            m_children.push_back(std::move(node));
+        }
 
-            bool equal = true;
-            int idx = 0;
-            std::for_each(m_children.begin(), m_children.end(), [this, &equal, other_root, &idx](const std::unique_ptr<ASTNode> &child)
-                          { equal = equal && child.get()->isEqual(other_root->m_children.at(idx).get()); ++idx; });
+        inline const Children &getChildren() const
+        {
+            return m_children;
+        }
 
-            return equal;
+        // identifiers of the program, the slots of its variables index them.
+        // nullptr for a tree that was not parsed, whose variables have no slot
+        inline const SymbolTable *getSymbols() const
+        {
+            return m_symbols.get();
         }
 
-        inline void printNode(int indent = 0) const override
+        // the names of the variables point into the table: the tree keeps it alive
+        inline void setSymbols(std::shared_ptr<const SymbolTable> symbols)
         {
-            std::cout << "RootNode" << std::endl;
-            std::for_each(m_children.begin(), m_children.end(), [this](const std::unique_ptr<ASTNode> &child)
-                          { child->printNode(1); });
+            m_symbols = std::move(symbols);
         }
 
-        inline void addNode(std::unique_ptr<ASTNode> node)
+        ~RootNode() override
         {
-            m_children.push_back(std::move(node));
+            for (auto &child : m_children)
+                destroyLater(std::move(child));
         }
 
     private:
-        std::vector<std::unique_ptr<ASTNode>>
-            m_children;
+        // moves the statements of an old tree in the new one
+        friend class IncrementalParser;
+
+        Children m_children;
+        std::shared_ptr<const SymbolTable> m_symbols;
     };
 
     // Top Level Non Terminals
     class ExpressionNode : public ASTNode
     {
+    protected:
+        // the expressions are numbers, variables or math expressions
+        ExpressionNode(NodeKind kind, std::uint64_t hash) : ASTNode(kind, hash) {}
+    };
+
+    // Terminal expressions
+    class NumberLiteralNode : public ExpressionNode
+    {
     public:
-        ExpressionNode() = default;
-        ExpressionNode(const std::string &terminal_expression) : m_terminal_expression(terminal_expression) {}
+        NumberLiteralNode(std::int64_t value) : ExpressionNode(NodeKind::NUMBER_LITERAL, hashOf(value, {})), m_value(value), m_digits() {}
+
+        // the digits are kept only by a number that overflows (value NUMBER_OVERFLOW, see Token::getNumber)
+        NumberLiteralNode(std::int64_t value, std::string_view digits) : ExpressionNode(NodeKind::NUMBER_LITERAL, hashOf(value, digits)), m_value(value), m_digits()
+        {
+            if (value == NUMBER_OVERFLOW)
+                m_digits = copyText(digits, m_owned_digits);
+        }
 
-        inline bool isEqual(ASTNode *other) const override
+        static inline std::uint64_t hashOf(std::int64_t value, std::string_view digits)
         {
-            auto other_expr = dynamic_cast<ExpressionNode *>(other);
-            if (other_expr == nullptr)
-                return false;
+            std::uint64_t hash = combineHash(hashKind(NodeKind::NUMBER_LITERAL), static_cast<std::uint64_t>(value));
+            return value == NUMBER_OVERFLOW ? combineHash(hash, hashText(digits)) : hash;
+        }
+
+        inline std::int64_t getValue() const
+        {
+            return m_value;
+        }
 
-            return m_terminal_expression == other_expr->m_terminal_expression;
+        // the value needs arbitrary precision, only the digits are known
+        inline bool isOverflow() const
+        {
+            return m_value == NUMBER_OVERFLOW;
         }
 
-        inline void printNode(int indent = 0) const override
+        // digits of a number that overflows, empty otherwise
+        inline std::string_view getDigits() const
         {
-            printIndentation("ExpressionNode", indent);
-            printIndentation(m_terminal_expression, indent + 2);
+            return m_digits;
+        }
+
+        // the value, or the digits if it overflows
+        inline std::string toString() const
+        {
+            return isOverflow() ? std::string(m_digits) : std::to_string(m_value);
         }
 
     private:
-        std::string m_terminal_expression;
+        std::int64_t m_value;
+        std::string_view m_digits;
+        std::unique_ptr<char[]> m_owned_digits;
     };
 
-    class StatementNode : public ASTNode
+    class VariableRefNode : public ExpressionNode
     {
     public:
-        virtual inline bool isEqual(ASTNode *other) const = 0;
-        virtual inline void printNode(int indent = 0) const = 0;
+        // a variable of a parsed program: the name is the one of its slot in the symbol table of the program
+        VariableRefNode(std::uint32_t slot, std::string_view name) : ExpressionNode(NodeKind::VARIABLE_REF, hashOf(name)), m_slot(slot), m_name(name) {}
+
+        // a variable out of any program, it keeps a copy of the name
+        VariableRefNode(std::string_view name) : ExpressionNode(NodeKind::VARIABLE_REF, hashOf(name)), m_slot(SymbolTable::NO_SLOT), m_name()
+        {
+            m_name = copyText(name, m_owned_name);
+        }
+
+        static inline std::uint64_t hashOf(std::string_view name)
+        {
+            return combineHash(hashKind(NodeKind::VARIABLE_REF), hashText(name));
+        }
+
+        inline std::string_view getName() const
+        {
+            return m_name;
+        }
 
-        StatementNode() = default;
+        // index of the name in the symbol table of the program (see RootNode::getSymbols),
+        // SymbolTable::NO_SLOT out of a program
+        inline std::uint32_t getSlot() const
+        {
+            return m_slot;
+        }
+
+    private:
+        // the slot is first, it goes in the padding of ASTNode
+        std::uint32_t m_slot;
+        std::string_view m_name;
+        std::unique_ptr<char[]> m_owned_name;
+    };
+
+    class StatementNode : public ASTNode
+    {
+    protected:
+        StatementNode(NodeKind kind, std::uint64_t hash) : ASTNode(kind, hash) {}
     };
 
     class PredicateNode : public ASTNode
     {
     public:
-        PredicateNode() = default;
-        PredicateNode(const std::string &terminal_predicate) : m_terminal_predicate(terminal_predicate) {}
+        PredicateNode() : PredicateNode(TokenType::UNKNOWN) {}
+
+        // TokenType::TRUE or TokenType::FALSE
+        PredicateNode(TokenType constant) : ASTNode(NodeKind::PREDICATE, hashOf(constant)), m_constant(constant) {}
+        PredicateNode(std::string_view terminal_predicate) : PredicateNode(operatorOf(terminal_predicate)) {}
+
+        static inline std::uint64_t hashOf(TokenType constant)
+        {
+            return combineHash(hashKind(NodeKind::PREDICATE), static_cast<std::uint64_t>(constant));
+        }
 
-        virtual bool isEqual(ASTNode *other) const override
+        // the hashes of the nodes above are not updated, call it before attaching the node
+        inline void setPredicate(TokenType constant)
         {
-            auto other_pred = dynamic_cast<PredicateNode *>(other);
-            if (other_pred == nullptr)
-                return false;
+            m_constant = constant;
+            setHash(hashOf(constant));
+        }
 
-            return m_terminal_predicate == other_pred->m_terminal_predicate;
+        inline void setPredicate(std::string_view s)
+        {
+            setPredicate(operatorOf(s));
         }
 
-        virtual void printNode(int indent = 0) const override
+        inline TokenType getConstant() const
         {
-            printIndentation("PredicateNode", indent);
-            printIndentation(m_terminal_predicate, indent + 2);
+            return m_constant;
         }
 
-        inline void setPredicate(const std::string &s)
+        inline std::string_view getTerminalPredicate() const
         {
-            m_terminal_predicate = s;
+            return tokenSpelling(m_constant);
         }
 
+    protected:
+        // for the derived predicates
+        PredicateNode(NodeKind kind, std::uint64_t hash) : ASTNode(kind, hash), m_constant(TokenType::UNKNOWN) {}
+
     private:
-        std::string m_terminal_predicate;
+        TokenType m_constant;
     };
 
     // Statement productions
     class AssignmentNode : public StatementNode
     {
     public:
-        AssignmentNode(const std::string &var_name, std::unique_ptr<ExpressionNode> expr)
-            : m_variable_name(var_name), m_expression(std::move(expr)) {}
+        // an assignment of a parsed program: the name is the one of its slot in the symbol table of the program
+        AssignmentNode(std::uint32_t slot, std::string_view var_name, std::unique_ptr<ExpressionNode> expr)
+            : StatementNode(NodeKind::ASSIGNMENT, hashOf(var_name, expr.get())), m_slot(slot), m_variable_name(var_name), m_expression(std::move(expr)) {}
 
-        inline bool isEqual(ASTNode *other) const override
+        // an assignment out of any program, it keeps a copy of the name
+        AssignmentNode(std::string_view var_name, std::unique_ptr<ExpressionNode> expr)
+            : StatementNode(NodeKind::ASSIGNMENT, hashOf(var_name, expr.get())), m_slot(SymbolTable::NO_SLOT), m_variable_name(), m_expression(std::move(expr))
         {
-            auto other_assign = dynamic_cast<AssignmentNode *>(other);
-            if (other_assign == nullptr)
-                return false;
+            m_variable_name = copyText(var_name, m_owned_name);
+        }
 
-            return m_variable_name == other_assign->m_variable_name && m_expression->isEqual(other_assign->m_expression.get());
+        static inline std::uint64_t hashOf(std::string_view var_name, const ExpressionNode *expr)
+        {
+            return combineHash(combineHash(hashKind(NodeKind::ASSIGNMENT), hashText(var_name)), hashChild(expr));
         }
 
-        inline void printNode(int indent = 0) const override
+        inline std::string_view getVariableName() const
         {
-            printIndentation("AssignmentNode", indent);
-            printIndentation("Identifier", indent + 1);
-            printIndentation(m_variable_name, indent + 2);
-            printIndentation("Expression", indent + 1);
-            m_expression->printNode(indent + 2);
+            return m_variable_name;
+        }
+
+        // same as VariableRefNode::getSlot
+        inline std::uint32_t getSlot() const
+        {
+            return m_slot;
+        }
+
+        inline const ExpressionNode *getExpression() const
+        {
+            return m_expression.get();
+        }
+
+        ~AssignmentNode() override
+        {
+            destroyLater(std::move(m_expression));
         }
 
     private:
-        std::string m_variable_name;
+        std::uint32_t m_slot;
+        std::string_view m_variable_name;
+        std::unique_ptr<char[]> m_owned_name;
         std::unique_ptr<ExpressionNode> m_expression;
     };
 
@@ -165,33 +396,40 @@ namespace WhileParser
     {
     public:
         IfNode(std::unique_ptr<PredicateNode> condition, std::unique_ptr<StatementNode> then_statement, std::unique_ptr<StatementNode> else_statement)
-            : m_condition(std::move(condition)), m_then_branch(std::move(then_statement)), m_else_branch(std::move(else_statement)) {}
+            : StatementNode(NodeKind::IF, hashOf(condition.get(), then_statement.get(), else_statement.get())),
+              m_condition(std::move(condition)), m_then_branch(std::move(then_statement)), m_else_branch(std::move(else_statement)) {}
 
-        inline bool isEqual(ASTNode *other) const override
+        static inline std::uint64_t hashOf(const PredicateNode *condition, const StatementNode *then_statement, const StatementNode *else_statement)
         {
-            auto other_if = dynamic_cast<IfNode *>(other);
-            if (other_if == nullptr)
-                return false;
+            std::uint64_t hash = combineHash(hashKind(NodeKind::IF), hashChild(condition));
+            return combineHash(combineHash(hash, hashChild(then_statement)), hashChild(else_statement));
+        }
 
-            return m_condition->isEqual(other_if->m_condition.get()) &&
-                   m_then_branch->isEqual(other_if->m_then_branch.get()) &&
-                   m_else_branch->isEqual(other_if->m_else_branch.get());
+        inline const PredicateNode *getCondition() const
+        {
+            return m_condition.get();
         }
 
-        inline void printNode(int indent = 0) const override
+        inline const StatementNode *getThenBranch() const
         {
-            printIndentation("IfNode", indent);
-            printIndentation("Condition", indent + 1);
-            m_condition->printNode(indent + 2);
+            return m_then_branch.get();
+        }
 
-            printIndentation("ThenBranch", indent + 1);
-            m_then_branch->printNode(indent + 2);
+        inline const StatementNode *getElseBranch() const
+        {
+            return m_else_branch.get();
+        }
 
-            printIndentation("ElseBranch", indent + 1);
-            m_else_branch->printNode(indent + 2);
+        ~IfNode() override
+        {
+            destroyLater(std::move(m_condition));
+            destroyLater(std::move(m_then_branch));
+            destroyLater(std::move(m_else_branch));
         }
 
     private:
+        friend class IncrementalParser;
+
         std::unique_ptr<PredicateNode> m_condition;
         std::unique_ptr<StatementNode> m_then_branch;
         std::unique_ptr<StatementNode> m_else_branch;
@@ -200,50 +438,39 @@ namespace WhileParser
     class SkipNode : public StatementNode
     {
     public:
-        SkipNode() = default;
-
-        inline bool isEqual(ASTNode *other) const override
-        {
-            auto other_skip = dynamic_cast<SkipNode *>(other);
-            if (other_skip == nullptr)
-                return false;
-
-            return true;
-        }
-
-        inline void printNode(int indent = 0) const override
-        {
-            printIndentation("SkipNode", indent);
-        }
+        SkipNode() : StatementNode(NodeKind::SKIP, hashKind(NodeKind::SKIP)) {}
     };
 
     class WhileNode : public StatementNode
     {
     public:
         WhileNode(std::unique_ptr<PredicateNode> condition, std::unique_ptr<StatementNode> statement)
-            : m_condition(std::move(condition)), m_statement(std::move(statement)) {}
+            : StatementNode(NodeKind::WHILE, hashOf(condition.get(), statement.get())), m_condition(std::move(condition)), m_statement(std::move(statement)) {}
 
-        inline bool isEqual(ASTNode *other) const override
+        static inline std::uint64_t hashOf(const PredicateNode *condition, const StatementNode *statement)
         {
-            auto other_while = dynamic_cast<WhileNode *>(other);
-            if (other_while == nullptr)
-                return false;
+            return combineHash(combineHash(hashKind(NodeKind::WHILE), hashChild(condition)), hashChild(statement));
+        }
 
-            return m_condition->isEqual(other_while->m_condition.get()) &&
-                   m_statement->isEqual(other_while->m_statement.get());
+        inline const PredicateNode *getCondition() const
+        {
+            return m_condition.get();
         }
 
-        inline void printNode(int indent = 0) const override
+        inline const StatementNode *getStatement() const
         {
-            printIndentation("WhileNode", indent);
-            printIndentation("Condition", indent + 1);
-            m_condition->printNode(indent + 2);
+            return m_statement.get();
+        }
 
-            printIndentation("Statement", indent + 1);
-            m_statement->printNode(indent + 2);
+        ~WhileNode() override
+        {
+            destroyLater(std::move(m_condition));
+            destroyLater(std::move(m_statement));
         }
 
     private:
+        friend class IncrementalParser;
+
         std::unique_ptr<PredicateNode> m_condition;
         std::unique_ptr<StatementNode> m_statement;
     };
@@ -252,46 +479,54 @@ namespace WhileParser
     class MathExpressionNode : public ExpressionNode
     {
     public:
-        MathExpressionNode(std::unique_ptr<ExpressionNode> expression) : m_math_operation(), m_left_expression(std::move(expression)),
-                                                                         m_right_expression(nullptr) {}
+        MathExpressionNode(std::unique_ptr<ExpressionNode> expression) : ExpressionNode(NodeKind::MATH_EXPRESSION, hashOf(TokenType::UNKNOWN, expression.get(), nullptr)),
+                                                                         m_math_operation(TokenType::UNKNOWN), m_left_expression(std::move(expression)), m_right_expression(nullptr) {}
 
-        MathExpressionNode(const std::string &math_operation, std::unique_ptr<ExpressionNode> left_expression,
-                           std::unique_ptr<ExpressionNode> right_expression) : m_math_operation(math_operation), m_left_expression(std::move(left_expression)),
+        // PLUS, MINUS, WILDCARD or SLASH
+        MathExpressionNode(TokenType math_operation, std::unique_ptr<ExpressionNode> left_expression,
+                           std::unique_ptr<ExpressionNode> right_expression) : ExpressionNode(NodeKind::MATH_EXPRESSION, hashOf(math_operation, left_expression.get(), right_expression.get())),
+                                                                               m_math_operation(math_operation), m_left_expression(std::move(left_expression)),
                                                                                m_right_expression(std::move(right_expression)) {}
-        inline bool isEqual(ASTNode *other) const override
-        {
-            auto other_mathexpr = dynamic_cast<MathExpressionNode *>(other);
-            if (other_mathexpr == nullptr)
-                return false;
 
-            return m_math_operation == other_mathexpr->m_math_operation &&
-                   m_left_expression->isEqual(other_mathexpr->m_left_expression.get()) &&
-                   m_right_expression->isEqual(other_mathexpr->m_right_expression.get());
-        }
+        MathExpressionNode(std::string_view math_operation, std::unique_ptr<ExpressionNode> left_expression, std::unique_ptr<ExpressionNode> right_expression)
+            : MathExpressionNode(operatorOf(math_operation), std::move(left_expression), std::move(right_expression)) {}
 
-        inline void printNode(int indent = 0) const override
+        static inline std::uint64_t hashOf(TokenType math_operation, const ExpressionNode *left_expression, const ExpressionNode *right_expression)
         {
+            std::uint64_t hash = combineHash(hashKind(NodeKind::MATH_EXPRESSION), static_cast<std::uint64_t>(math_operation));
+            return combineHash(combineHash(hash, hashChild(left_expression)), hashChild(right_expression));
+        }
 
-            if (m_math_operation.empty() || !m_right_expression)
-            {
+        // UNKNOWN for the single operand form
+        inline TokenType getOpcode() const
+        {
+            return m_math_operation;
+        }
 
-                m_left_expression->printNode(indent);
-                return;
-            }
-            printIndentation("MathExpressionNode", indent);
+        // empty for the single operand form
+        inline std::string_view getOperation() const
+        {
+            return tokenSpelling(m_math_operation);
+        }
 
-            printIndentation("MathOp", indent + 1);
-            printIndentation("(" + m_math_operation + ")", indent + 2);
+        inline const ExpressionNode *getLeftExpression() const
+        {
+            return m_left_expression.get();
+        }
 
-            printIndentation("LeftSideExpression", indent + 1);
-            m_left_expression->printNode(indent + 2);
+        inline const ExpressionNode *getRightExpression() const
+        {
+            return m_right_expression.get();
+        }
 
-            printIndentation("RightSideExpression", indent + 1);
-            m_right_expression->printNode(indent + 2);
+        ~MathExpressionNode() override
+        {
+            destroyLater(std::move(m_left_expression));
+            destroyLater(std::move(m_right_expression));
         }
 
     private:
-        std::string m_math_operation;
+        TokenType m_math_operation;
         std::unique_ptr<ExpressionNode> m_left_expression;
         std::unique_ptr<ExpressionNode> m_right_expression;
     };
@@ -300,21 +535,21 @@ namespace WhileParser
     class NotPredicateNode : public PredicateNode
     {
     public:
-        NotPredicateNode(std::unique_ptr<PredicateNode> predicate) : m_predicate(std::move(predicate)) {}
+        NotPredicateNode(std::unique_ptr<PredicateNode> predicate) : PredicateNode(NodeKind::NOT_PREDICATE, hashOf(predicate.get())), m_predicate(std::move(predicate)) {}
 
-        inline bool isEqual(ASTNode *other) const override
+        static inline std::uint64_t hashOf(const PredicateNode *predicate)
         {
-            auto other_notpred = dynamic_cast<NotPredicateNode *>(other);
-            if (other_notpred == nullptr)
-                return false;
+            return combineHash(hashKind(NodeKind::NOT_PREDICATE), hashChild(predicate));
+        }
 
-            return m_predicate->isEqual(other_notpred->m_predicate.get());
+        inline const PredicateNode *getPredicate() const
+        {
+            return m_predicate.get();
         }
 
-        inline void printNode(int indent = 0) const override
+        ~NotPredicateNode() override
         {
-            printIndentation("NotPredicateNode", indent);
-            m_predicate->printNode(indent + 1);
+            destroyLater(std::move(m_predicate));
         }
 
     private:
@@ -324,37 +559,49 @@ namespace WhileParser
     class BooleanPredicateNode : public PredicateNode
     {
     public:
-        BooleanPredicateNode(const std::string &boolean_operation, std::unique_ptr<PredicateNode> left_predicate,
-                             std::unique_ptr<PredicateNode> right_predicate) : m_boolean_operation(boolean_operation), m_left_predicate(std::move(left_predicate)),
+        // AND or OR
+        BooleanPredicateNode(TokenType boolean_operation, std::unique_ptr<PredicateNode> left_predicate,
+                             std::unique_ptr<PredicateNode> right_predicate) : PredicateNode(NodeKind::BOOLEAN_PREDICATE, hashOf(boolean_operation, left_predicate.get(), right_predicate.get())),
+                                                                               m_boolean_operation(boolean_operation), m_left_predicate(std::move(left_predicate)),
                                                                                m_right_predicate(std::move(right_predicate)) {}
 
-        inline bool isEqual(ASTNode *other) const override
+        BooleanPredicateNode(std::string_view boolean_operation, std::unique_ptr<PredicateNode> left_predicate, std::unique_ptr<PredicateNode> right_predicate)
+            : BooleanPredicateNode(operatorOf(boolean_operation), std::move(left_predicate), std::move(right_predicate)) {}
+
+        static inline std::uint64_t hashOf(TokenType boolean_operation, const PredicateNode *left_predicate, const PredicateNode *right_predicate)
         {
-            auto other_boolpred = dynamic_cast<BooleanPredicateNode *>(other);
-            if (other_boolpred == nullptr)
-                return false;
+            std::uint64_t hash = combineHash(hashKind(NodeKind::BOOLEAN_PREDICATE), static_cast<std::uint64_t>(boolean_operation));
+            return combineHash(combineHash(hash, hashChild(left_predicate)), hashChild(right_predicate));
+        }
 
-            return m_boolean_operation == other_boolpred->m_boolean_operation &&
-                   m_left_predicate->isEqual(other_boolpred->m_left_predicate.get()) &&
-                   m_right_predicate->isEqual(other_boolpred->m_right_predicate.get());
+        inline TokenType getOpcode() const
+        {
+            return m_boolean_operation;
         }
 
-        inline void printNode(int indent = 0) const override
+        inline std::string_view getOperation() const
         {
-            printIndentation("BooleanPredicateNode", indent);
+            return tokenSpelling(m_boolean_operation);
+        }
 
-            printIndentation("BooleanOp", indent + 1);
-            printIndentation(m_boolean_operation, indent + 2);
+        inline const PredicateNode *getLeftPredicate() const
+        {
+            return m_left_predicate.get();
+        }
 
-            printIndentation("LeftSidePredicate", indent + 1);
-            m_left_predicate->printNode(indent + 2);
+        inline const PredicateNode *getRightPredicate() const
+        {
+            return m_right_predicate.get();
+        }
 
-            printIndentation("RightSidePredicate", indent + 1);
-            m_right_predicate->printNode(indent + 2);
+        ~BooleanPredicateNode() override
+        {
+            destroyLater(std::move(m_left_predicate));
+            destroyLater(std::move(m_right_predicate));
         }
 
     private:
-        std::string m_boolean_operation;
+        TokenType m_boolean_operation;
         std::unique_ptr<PredicateNode> m_left_predicate;
         std::unique_ptr<PredicateNode> m_right_predicate;
     };
@@ -362,51 +609,117 @@ namespace WhileParser
     class RelationalPredicateNode : public PredicateNode
     {
     public:
-        RelationalPredicateNode(std::unique_ptr<ExpressionNode> expression) : m_relational_operation(), m_left_expression(std::move(expression)),
-                                                                              m_right_expression(nullptr) {}
+        RelationalPredicateNode(std::unique_ptr<ExpressionNode> expression) : PredicateNode(NodeKind::RELATIONAL_PREDICATE, hashOf(TokenType::UNKNOWN, expression.get(), nullptr)),
+                                                                              m_relational_operation(TokenType::UNKNOWN), m_left_expression(std::move(expression)), m_right_expression(nullptr) {}
 
-        RelationalPredicateNode(const std::string &relational_operation, std::unique_ptr<ExpressionNode> left_expression,
-                                std::unique_ptr<ExpressionNode> right_expression) : m_relational_operation(relational_operation), m_left_expression(std::move(left_expression)),
+        // EQ, LT, LTE, GT or GTE
+        RelationalPredicateNode(TokenType relational_operation, std::unique_ptr<ExpressionNode> left_expression,
+                                std::unique_ptr<ExpressionNode> right_expression) : PredicateNode(NodeKind::RELATIONAL_PREDICATE, hashOf(relational_operation, left_expression.get(), right_expression.get())),
+                                                                                    m_relational_operation(relational_operation), m_left_expression(std::move(left_expression)),
                                                                                     m_right_expression(std::move(right_expression))
         {
         }
 
-        inline bool isEqual(ASTNode *other) const override
-        {
-            auto other_relpred = dynamic_cast<RelationalPredicateNode *>(other);
-            if (other_relpred == nullptr)
-                return false;
+        RelationalPredicateNode(std::string_view relational_operation, std::unique_ptr<ExpressionNode> left_expression, std::unique_ptr<ExpressionNode> right_expression)
+            : RelationalPredicateNode(operatorOf(relational_operation), std::move(left_expression), std::move(right_expression)) {}
 
-            return m_relational_operation == other_relpred->m_relational_operation &&
-                   m_left_expression->isEqual(other_relpred->m_left_expression.get()) &&
-                   m_right_expression->isEqual(other_relpred->m_right_expression.get());
+        static inline std::uint64_t hashOf(TokenType relational_operation, const ExpressionNode *left_expression, const ExpressionNode *right_expression)
+        {
+            std::uint64_t hash = combineHash(hashKind(NodeKind::RELATIONAL_PREDICATE), static_cast<std::uint64_t>(relational_operation));
+            return combineHash(combineHash(hash, hashChild(left_expression)), hashChild(right_expression));
         }
 
-        inline void printNode(int indent = 0) const override
+        // UNKNOWN for the single expression form
+        inline TokenType getOpcode() const
         {
+            return m_relational_operation;
+        }
 
-            if (m_relational_operation.empty() || !m_right_expression)
-            {
-                printIndentation("Expression", indent);
-                m_left_expression->printNode(indent + 1);
-                return;
-            }
-            printIndentation("RelationalPredicateNode", indent);
+        // empty for the single expression form
+        inline std::string_view getOperation() const
+        {
+            return tokenSpelling(m_relational_operation);
+        }
 
-            printIndentation("RelationalOp", indent + 1);
-            printIndentation(m_relational_operation, indent + 2);
+        inline const ExpressionNode *getLeftExpression() const
+        {
+            return m_left_expression.get();
+        }
 
-            printIndentation("LeftSideExpression", indent + 1);
-            m_left_expression->printNode(indent + 2);
+        inline const ExpressionNode *getRightExpression() const
+        {
+            return m_right_expression.get();
+        }
 
-            printIndentation("RightSideExpression", indent + 1);
-            m_right_expression->printNode(indent + 2);
+        ~RelationalPredicateNode() override
+        {
+            destroyLater(std::move(m_left_expression));
+            destroyLater(std::move(m_right_expression));
         }
 
     private:
-        std::string m_relational_operation;
+        TokenType m_relational_operation;
         std::unique_ptr<ExpressionNode> m_left_expression;
         std::unique_ptr<ExpressionNode> m_right_expression;
     };
+
+    // Tree whose nodes and texts were all allocated in one arena (see Parser::parseInArena).
+    // No node destructor runs: the whole tree is released at once with the arena.
+    class ArenaTree
+    {
+    public:
+        ArenaTree(std::unique_ptr<Arena> arena, RootNode *root) : m_arena(std::move(arena)), m_root(root) {}
+
+        ArenaTree(ArenaTree &&other) noexcept : m_arena(std::move(other.m_arena)), m_root(other.m_root)
+        {
+            other.m_root = nullptr;
+        }
+
+        ArenaTree &operator=(ArenaTree &&other) noexcept
+        {
+            release();
+            m_arena = std::move(other.m_arena);
+            m_root = other.m_root;
+            other.m_root = nullptr;
+            return *this;
+        }
+
+        ~ArenaTree()
+        {
+            release();
+        }
+
+        inline RootNode *get() const
+        {
+            return m_root;
+        }
+
+        inline RootNode *operator->() const
+        {
+            return m_root;
+        }
+
+        inline RootNode &operator*() const
+        {
+            return *m_root;
+        }
+
+        inline const Arena &getArena() const
+        {
+            return *m_arena;
+        }
+
+    private:
+        // the destructors of the nodes don't run in an arena, the reference of the root to its
+        // symbol table is dropped here
+        inline void release()
+        {
+            if (m_root)
+                m_root->setSymbols(nullptr);
+        }
+
+        std::unique_ptr<Arena> m_arena;
+        RootNode *m_root;
+    };
 }
-#endif
+#endif
\ No newline at end of file
@@ -0,0 +1,152 @@
+#ifndef HH_ARENA_INCLUDE_GUARD
+#define HH_ARENA_INCLUDE_GUARD 1
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <string_view>
+
+namespace WhileParser
+{
+
+    // Bump allocator: memory is handed out from big blocks and is only given back
+    // all together when the arena is destroyed. Destructors of the objects built in it never run.
+    class Arena
+    {
+    public:
+        static constexpr std::size_t DEFAULT_BLOCK_SIZE = 64 * 1024;
+        static constexpr std::size_t MAX_BLOCK_SIZE = 16 * 1024 * 1024;
+
+        Arena(std::size_t block_size = DEFAULT_BLOCK_SIZE);
+        ~Arena();
+
+        Arena(const Arena &) = delete;
+        Arena &operator=(const Arena &) = delete;
+
+        inline void *allocate(std::size_t size, std::size_t alignment)
+        {
+            std::uintptr_t start = (m_cursor + alignment - 1) & ~(static_cast<std::uintptr_t>(alignment) - 1);
+            if (start + size <= m_end)
+            {
+                m_cursor = start + size;
+                return reinterpret_cast<void *>(start);
+            }
+            return allocateSlow(size, alignment);
+        }
+
+        // copies the text in the arena, the view is valid as long as the arena
+        std::string_view copy(std::string_view text);
+
+        inline std::size_t getBlockCount() const
+        {
+            return m_blocks;
+        }
+
+        inline std::size_t getReservedBytes() const
+        {
+            return m_reserved;
+        }
+
+        // arena used by the allocations of AST nodes on this thread, nullptr means the heap
+        static inline Arena *active()
+        {
+            return s_active;
+        }
+
+        // allocation functions of the AST nodes, in the active arena if any. deallocateNode is
+        // for a node whose constructor threw, so the arena that was active for its allocation
+        // still is: it doesn't give back memory that belongs to the arena
+        static void *allocateNode(std::size_t size);
+        static void deallocateNode(void *node);
+
+    private:
+        friend class ArenaScope;
+
+        struct Block
+        {
+            Block *next;
+        };
+
+        void *allocateSlow(std::size_t size, std::size_t alignment);
+
+        Block *m_head;
+        std::uintptr_t m_cursor;
+        std::uintptr_t m_end;
+        std::size_t m_next_block_size;
+        std::size_t m_blocks;
+        std::size_t m_reserved;
+
+        static thread_local Arena *s_active;
+    };
+
+    // Makes an arena the active one on this thread for its lifetime
+    class ArenaScope
+    {
+    public:
+        ArenaScope(Arena *arena) : m_previous(Arena::s_active)
+        {
+            Arena::s_active = arena;
+        }
+
+        ~ArenaScope()
+        {
+            Arena::s_active = m_previous;
+        }
+
+        ArenaScope(const ArenaScope &) = delete;
+        ArenaScope &operator=(const ArenaScope &) = delete;
+
+    private:
+        Arena *m_previous;
+    };
+
+    // Standard allocator that takes memory from the arena active when it was built,
+    // or from the heap if there was none. Memory of the arena is never given back.
+    template <typename T>
+    class ArenaAllocator
+    {
+    public:
+        using value_type = T;
+
+        ArenaAllocator() : m_arena(Arena::active()) {}
+
+        template <typename U>
+        ArenaAllocator(const ArenaAllocator<U> &other) : m_arena(other.getArena()) {}
+
+        inline T *allocate(std::size_t count)
+        {
+            if (m_arena)
+                return static_cast<T *>(m_arena->allocate(count * sizeof(T), alignof(T)));
+            return std::allocator<T>().allocate(count);
+        }
+
+        inline void deallocate(T *pointer, std::size_t count)
+        {
+            if (!m_arena)
+                std::allocator<T>().deallocate(pointer, count);
+        }
+
+        inline Arena *getArena() const
+        {
+            return m_arena;
+        }
+
+        template <typename U>
+        inline bool operator==(const ArenaAllocator<U> &other) const
+        {
+            return m_arena == other.getArena();
+        }
+
+        template <typename U>
+        inline bool operator!=(const ArenaAllocator<U> &other) const
+        {
+            return m_arena != other.getArena();
+        }
+
+    private:
+        Arena *m_arena;
+    };
+}
+
+#endif
@@ -0,0 +1,65 @@
+#ifndef HH_BATCH_PARSER_INCLUDE_GUARD
+#define HH_BATCH_PARSER_INCLUDE_GUARD 1
+
+#include "./ParseCache.hpp"
+#include "./ParserPool.hpp"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace WhileParser
+{
+
+    // Outcome of the parse of one file of a batch
+    struct FileResult
+    {
+        std::string path;
+        bool ok;
+        std::size_t errors;     // syntax errors found
+        std::string message;    // the first error, or why the file couldn't be read
+        bool cached;            // it passed without being parsed, its tree was in the cache
+        std::size_t bytes;
+        double milliseconds;
+    };
+
+    // Validates many .wh files on a pool of threads.
+    // Every worker has its own queue of files and takes the biggest first; a worker whose queue is
+    // empty steals the smallest files left in the queue of another one, so the workers finish
+    // together even when the sizes of the files are very different.
+    // The parsers of the workers are kept in a pool, and the next batches reuse them.
+    class BatchParser
+    {
+    public:
+        BatchParser(unsigned threads = 0);
+
+        // the results are in the same order as the paths
+        std::vector<FileResult> parseFiles(const std::vector<std::string> &paths);
+
+        // the .wh files of a directory (and its subdirectories, sorted), a .wh file itself,
+        // or the paths listed in any other file, one per line
+        static std::vector<std::string> collectFiles(const std::string &path);
+
+        inline unsigned getThreads() const
+        {
+            return m_threads;
+        }
+
+        // the files found in the cache are not parsed, the others are stored if they pass.
+        // The cache isn't owned, it has to outlive the batch
+        inline void setCache(ParseCache *cache)
+        {
+            m_cache = cache;
+        }
+
+    private:
+        FileResult parseFile(const std::string &path, Parser &parser) const;
+
+        unsigned m_threads;
+        ParseCache *m_cache;
+        // every worker resets the same parser on each of its files
+        ParserPool m_parsers;
+    };
+}
+
+#endif
@@ -0,0 +1,75 @@
+#ifndef HH_DFA_LEXER_INCLUDE_GUARD
+#define HH_DFA_LEXER_INCLUDE_GUARD 1
+
+#include "./Token.hpp"
+#include "./TokenType.hpp"
+#include "./TokenStream.hpp"
+#include "./SourceBuffer.hpp"
+
+#include <array>
+#include <cstdint>
+#include <memory>
+
+namespace WhileParser
+{
+
+    // Alternative lexer engine driven by a character-class table and a state-transition table.
+    // Every token, skipped whitespaces and newlines included, is recognized by a single loop
+    // over the buffer, so there is no recursion however long the trivia runs are.
+    // It produces the same tokens, values and offsets as Lexer.
+    class DfaLexer
+    {
+    public:
+        enum CharacterClass : std::uint8_t
+        {
+            CLASS_OTHER,
+            CLASS_LETTER,
+            CLASS_UNDERSCORE,
+            CLASS_DIGIT,
+            CLASS_SPACE,
+            CLASS_NEWLINE,
+            CLASS_COMPOUND_PREFIX, // : < >
+            CLASS_EQUALS,
+            CLASS_SYMBOL, // ; + - * / ( )
+            CLASS_COUNT
+        };
+
+        enum State : std::uint8_t
+        {
+            STATE_START,
+            STATE_IDENTIFIER,
+            STATE_NUMBER,
+            STATE_NUMBER_LETTER, // a digit run immediately followed by a letter
+            STATE_COMPOUND_PREFIX,
+            STATE_SYMBOL,
+            STATE_SPACE,
+            STATE_NEWLINE,
+            STATE_OTHER,
+            STATE_DEAD,
+            STATE_COUNT
+        };
+
+        using TransitionTable = std::array<std::array<State, CLASS_COUNT>, STATE_COUNT>;
+
+        DfaLexer(std::shared_ptr<const SourceBuffer> source, bool skip_whitespaces, bool skip_eol);
+
+        Token nextToken();
+        TokenStream tokenizeAll();
+
+        inline bool isTokenAvailable() const
+        {
+            return !m_eof;
+        }
+
+    private:
+        Token accept(State state, const char *start);
+
+        std::shared_ptr<const SourceBuffer> m_source;
+        const TransitionTable *m_transitions;
+        const char *m_cursor;
+        const char *m_end;
+        bool m_eof;
+    };
+}
+
+#endif
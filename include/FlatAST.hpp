@@ -0,0 +1,171 @@
+#ifndef HH_FLAT_AST_INCLUDE_GUARD
+#define HH_FLAT_AST_INCLUDE_GUARD 1
+
+#include "./AST.hpp"
+#include "./SourceBuffer.hpp"
+#include "./TokenType.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace WhileParser
+{
+
+    // Flat version of an AST: the nodes are packed in a contiguous array in pre-order and refer
+    // to each other by 32-bit indices, the texts are interned once in a single pool.
+    // The first child of a node is the next one in the array, and every node knows where its
+    // subtree ends, that is where its next sibling starts.
+    // It can be saved to a binary file and loaded back by mapping it: the arrays are used in
+    // place, so a loaded program is traversed without building any node.
+    class FlatAST
+    {
+    public:
+        using NodeIndex = std::uint32_t;
+        static constexpr NodeIndex NO_NODE = std::numeric_limits<NodeIndex>::max();
+        static constexpr std::uint32_t NO_TEXT = std::numeric_limits<std::uint32_t>::max();
+        static constexpr std::uint64_t NO_NUMBER = std::numeric_limits<std::uint64_t>::max();
+        // bumped at every change of the file layout, files of other versions are rejected
+        static constexpr std::uint32_t FORMAT_VERSION = 3;
+
+        struct Node
+        {
+            NodeKind kind;
+            TokenType op;       // operator of the math, boolean and relational nodes, TRUE/FALSE for the predicates, UNKNOWN if there is none
+            NodeIndex end;      // one past the last node of the subtree
+            std::uint32_t text; // interned text of numbers, variables and assigned variables
+        };
+
+        // converts the tree without recursion, so any depth is fine.
+        // It throws a std::invalid_argument if a node has a null child
+        static FlatAST fromTree(const RootNode &root);
+
+        // maps a file written by save(), after checking that its header and its indices are
+        // valid. The arrays are read in place for as long as the FlatAST (or a copy) lives
+        static FlatAST load(const std::string &filename);
+
+        FlatAST(const FlatAST &other);
+        FlatAST &operator=(const FlatAST &other);
+        FlatAST(FlatAST &&) = default;
+        FlatAST &operator=(FlatAST &&) = default;
+
+        // writes the header, the node table, the text offsets, the number values and the text pool
+        void save(const std::string &filename) const;
+
+        // builds back the pointer based tree
+        std::unique_ptr<RootNode> toTree() const;
+
+        inline std::size_t size() const
+        {
+            return m_node_count;
+        }
+
+        inline const Node &getNode(NodeIndex idx) const
+        {
+            return m_node_data[idx];
+        }
+
+        inline NodeKind getKind(NodeIndex idx) const
+        {
+            return m_node_data[idx].kind;
+        }
+
+        inline TokenType getOperator(NodeIndex idx) const
+        {
+            return m_node_data[idx].op;
+        }
+
+        inline std::string_view getText(NodeIndex idx) const
+        {
+            std::uint32_t text = m_node_data[idx].text;
+            if (text == NO_TEXT)
+                return {};
+            return std::string_view(m_pool_data + m_offset_data[text], m_offset_data[text + 1] - m_offset_data[text]);
+        }
+
+        // value of a number literal, NO_NUMBER for the other nodes and for literals that don't fit 64 bits
+        inline std::uint64_t getNumber(NodeIndex idx) const
+        {
+            std::uint32_t text = m_node_data[idx].text;
+            return text == NO_TEXT ? NO_NUMBER : m_number_data[text];
+        }
+
+        inline NodeIndex getSubtreeEnd(NodeIndex idx) const
+        {
+            return m_node_data[idx].end;
+        }
+
+        inline NodeIndex firstChild(NodeIndex idx) const
+        {
+            return m_node_data[idx].end > idx + 1 ? idx + 1 : NO_NODE;
+        }
+
+        // the sibling that follows child inside parent
+        inline NodeIndex nextSibling(NodeIndex parent, NodeIndex child) const
+        {
+            NodeIndex next = m_node_data[child].end;
+            return next < m_node_data[parent].end ? next : NO_NODE;
+        }
+
+        template <typename Visitor>
+        inline void forEachChild(NodeIndex idx, Visitor visit) const
+        {
+            for (NodeIndex child = firstChild(idx); child != NO_NODE; child = nextSibling(idx, child))
+                visit(child);
+        }
+
+        std::size_t childCount(NodeIndex idx) const;
+
+        // n-th child of a node, NO_NODE if it has less children
+        NodeIndex getChild(NodeIndex idx, std::size_t n) const;
+
+        // number of distinct texts in the pool
+        inline std::size_t getTextCount() const
+        {
+            return m_text_count;
+        }
+
+        // a loaded FlatAST reads its arrays from the mapped file
+        inline bool isMapped() const
+        {
+            return m_file != nullptr;
+        }
+
+        // bytes taken by nodes and texts, on the heap or in the mapped file
+        std::size_t memoryUsage() const;
+
+        // structural equality, a linear scan of the two arrays
+        bool isEqual(const FlatAST &other) const;
+
+    private:
+        FlatAST() = default;
+
+        // points the views to the owned arrays
+        void bindArrays();
+
+        std::vector<Node> m_nodes;
+        std::vector<char> m_pool;
+        std::vector<std::uint32_t> m_text_offsets; // text i is [offsets[i], offsets[i + 1]) in the pool
+        std::vector<std::uint64_t> m_numbers;      // value of text i, if it is a number literal
+
+        // the accessors only use the views, that point to the arrays above or into m_file
+        std::shared_ptr<const SourceBuffer> m_file;
+        const Node *m_node_data = nullptr;
+        std::size_t m_node_count = 0;
+        const char *m_pool_data = nullptr;
+        const std::uint32_t *m_offset_data = nullptr;
+        std::size_t m_text_count = 0;
+        const std::uint64_t *m_number_data = nullptr;
+    };
+
+    // a node is stored in the file as it is in memory
+    static_assert(sizeof(FlatAST::Node) == 12 && std::is_standard_layout_v<FlatAST::Node>,
+                  "FlatAST::Node must keep the layout of the file format");
+}
+
+#endif
@@ -0,0 +1,136 @@
+#ifndef HH_INCREMENTAL_PARSER_INCLUDE_GUARD
+#define HH_INCREMENTAL_PARSER_INCLUDE_GUARD 1
+
+#include "./AST.hpp"
+#include "./Parser.hpp"
+#include "./SourceBuffer.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace WhileParser
+{
+
+    // Keeps the tree of a program that is edited, e.g. in an editor, up to date.
+    // An edit re-lexes and reparses only the statements it touches: the top level statements before
+    // and after it, and the nested statements whose text it didn't change, are moved in the new tree as they are.
+    // Errors don't stop the parse (see Parser::parseWithDiagnostics): the errors are in getDiagnostics(),
+    // and the top level statements with errors are null children of the tree
+    class IncrementalParser
+    {
+    public:
+        IncrementalParser(std::string source);
+
+        IncrementalParser(const IncrementalParser &) = delete;
+        IncrementalParser &operator=(const IncrementalParser &) = delete;
+
+        // replaces the removed characters that start at offset with the inserted ones
+        void edit(std::size_t offset, std::size_t removed, std::string_view inserted);
+
+        // A top level statement with an error is a null child of the root, also when the error is in
+        // a statement nested in it: the nodes below the root are always complete, none has a null child.
+        // FlatAST::fromTree rejects a tree with errors
+        inline const RootNode &getTree() const
+        {
+            return *m_root;
+        }
+
+        // sorted by offset, that is in the current source
+        inline const std::vector<Diagnostic> &getDiagnostics() const
+        {
+            return m_diagnostics;
+        }
+
+        inline bool ok() const
+        {
+            return m_diagnostics.empty();
+        }
+
+        inline std::string_view getSource() const
+        {
+            return m_source->text();
+        }
+
+        // characters of the source that the last edit (or the first parse) lexed and parsed again
+        inline std::size_t getReparsedBytes() const
+        {
+            return m_reparsed_bytes;
+        }
+
+    private:
+        friend class Parser;
+
+        // Where the text of a statement is: its first character and the end of its last token.
+        // Its hash is kept here too, the one of the tree is made from them without going through the nodes
+        struct TopLevelSpan
+        {
+            std::size_t begin;
+            std::size_t end;
+            std::uint64_t hash;
+            bool clean; // no errors in it, so it can be reused
+        };
+
+        // nested statement: begin is relative to the statement it's nested in, so moving a subtree
+        // doesn't change the spans inside it
+        struct NestedSpan
+        {
+            std::size_t begin;
+            std::size_t length;
+        };
+
+        // statement being parsed, with the old statement in the same place (nullptr if there was none)
+        struct Frame
+        {
+            StatementNode *old;
+            std::size_t old_begin;
+            std::size_t new_begin;
+            std::size_t slot; // next nested statement of old to compare
+        };
+
+        // the edit being applied
+        struct Edit
+        {
+            std::size_t offset;
+            std::size_t removed;
+            std::size_t inserted;
+        };
+
+        // parses again from the top level statement first, that starts at offset start
+        void reparse(std::size_t first, std::size_t start);
+
+        // hooks of Parser::parseStatement(): the old statement that can be moved where the parser is,
+        // with the end of its text, or nullptr; endStatement() closes a statement that was parsed
+        std::unique_ptr<StatementNode> takeStatement(std::size_t begin, std::size_t &end);
+        void endStatement(const StatementNode *statement, std::size_t begin, std::size_t end, bool clean);
+
+        // where the text of an old statement is after the edit, if the edit didn't touch it
+        bool isMoved(std::size_t begin, std::size_t length, std::size_t &moved) const;
+        static std::unique_ptr<StatementNode> *slotOf(StatementNode *parent, std::size_t slot);
+        void forgetSpans(const ASTNode *discarded);
+
+        std::shared_ptr<const SourceBuffer> m_source;
+        std::unique_ptr<RootNode> m_root;
+        // one table for all the parses, the moved statements keep their slots. It only grows:
+        // the identifiers that the edits removed keep theirs
+        std::shared_ptr<SymbolTable> m_symbols;
+        std::vector<Diagnostic> m_diagnostics;
+        std::size_t m_reparsed_bytes;
+
+        std::vector<TopLevelSpan> m_top_level; // parallel to the children of m_root
+        std::unordered_map<const ASTNode *, NestedSpan> m_nested;
+
+        // state of reparse()
+        Edit m_edit;
+        std::vector<Frame> m_frames;
+        StatementNode *m_top_candidate;
+        std::size_t m_top_candidate_begin;
+        std::size_t m_reused_bytes;
+    };
+
+}
+
+#endif
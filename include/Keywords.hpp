@@ -0,0 +1,184 @@
+#ifndef HH_KEYWORDS_INCLUDE_GUARD
+#define HH_KEYWORDS_INCLUDE_GUARD 1
+
+#include "./TokenType.hpp"
+
+#include <cstddef>
+#include <string_view>
+
+namespace WhileParser
+{
+    // The vocabulary of the language is fixed, so keywords and symbols are recognized by
+    // switches on length and characters that are resolved at compile time: no table is built
+    // at runtime and no temporary string is needed.
+
+    // Returns the keyword type of an identifier-like word, IDENTIFIER if the word isn't reserved
+    constexpr TokenType classifyWord(std::string_view word)
+    {
+        switch (word.size())
+        {
+        case 2:
+            switch (word[0])
+            {
+            case 'i':
+                return word[1] == 'f' ? TokenType::IF : TokenType::IDENTIFIER;
+            case 'd':
+                return word[1] == 'o' ? TokenType::DO : TokenType::IDENTIFIER;
+            case 'o':
+                return word[1] == 'r' ? TokenType::OR : TokenType::IDENTIFIER;
+            }
+            break;
+        case 3:
+            if (word == "and")
+                return TokenType::AND;
+            if (word == "not")
+                return TokenType::NOT;
+            break;
+        case 4:
+            switch (word[0])
+            {
+            case 's':
+                return word == "skip" ? TokenType::SKIP : TokenType::IDENTIFIER;
+            case 't':
+                if (word == "then")
+                    return TokenType::THEN;
+                return word == "true" ? TokenType::TRUE : TokenType::IDENTIFIER;
+            case 'e':
+                return word == "else" ? TokenType::ELSE : TokenType::IDENTIFIER;
+            }
+            break;
+        case 5:
+            switch (word[0])
+            {
+            case 'e':
+                return word == "endif" ? TokenType::ENDIF : TokenType::IDENTIFIER;
+            case 'w':
+                return word == "while" ? TokenType::WHILE : TokenType::IDENTIFIER;
+            case 'f':
+                return word == "false" ? TokenType::FALSE : TokenType::IDENTIFIER;
+            }
+            break;
+        case 8:
+            return word == "endwhile" ? TokenType::ENDWHILE : TokenType::IDENTIFIER;
+        }
+
+        return TokenType::IDENTIFIER;
+    }
+
+    // Returns the type of the symbol starting with first, looking ahead at next for the compound
+    // symbols :=, <= and >=. length receives the number of characters that make up the symbol.
+    constexpr TokenType classifySymbol(char first, char next, std::size_t &length)
+    {
+        length = 1;
+        switch (first)
+        {
+        case ' ':
+            return TokenType::WHITESPACE;
+        case '\n':
+            return TokenType::END_OF_LINE;
+        case ';':
+            return TokenType::SEMICOLON;
+        case '+':
+            return TokenType::PLUS;
+        case '-':
+            return TokenType::MINUS;
+        case '*':
+            return TokenType::WILDCARD;
+        case '/':
+            return TokenType::SLASH;
+        case '=':
+            return TokenType::EQ;
+        case '(':
+            return TokenType::LPAREN;
+        case ')':
+            return TokenType::RPAREN;
+        case ':':
+            if (next != '=')
+                return TokenType::UNKNOWN;
+            length = 2;
+            return TokenType::ASSIGN;
+        case '<':
+            if (next != '=')
+                return TokenType::LT;
+            length = 2;
+            return TokenType::LTE;
+        case '>':
+            if (next != '=')
+                return TokenType::GT;
+            length = 2;
+            return TokenType::GTE;
+        }
+
+        return TokenType::UNKNOWN;
+    }
+
+    // Returns the fixed spelling of keywords and symbols, empty for the types that have a variable lexeme
+    constexpr std::string_view tokenSpelling(TokenType type)
+    {
+        switch (type)
+        {
+        case TokenType::WHITESPACE:
+            return " ";
+        case TokenType::END_OF_LINE:
+            return "\n";
+        case TokenType::SKIP:
+            return "skip";
+        case TokenType::IF:
+            return "if";
+        case TokenType::THEN:
+            return "then";
+        case TokenType::ELSE:
+            return "else";
+        case TokenType::ENDIF:
+            return "endif";
+        case TokenType::WHILE:
+            return "while";
+        case TokenType::DO:
+            return "do";
+        case TokenType::ENDWHILE:
+            return "endwhile";
+        case TokenType::TRUE:
+            return "true";
+        case TokenType::FALSE:
+            return "false";
+        case TokenType::AND:
+            return "and";
+        case TokenType::OR:
+            return "or";
+        case TokenType::NOT:
+            return "not";
+        case TokenType::SEMICOLON:
+            return ";";
+        case TokenType::ASSIGN:
+            return ":=";
+        case TokenType::EQ:
+            return "=";
+        case TokenType::LT:
+            return "<";
+        case TokenType::LTE:
+            return "<=";
+        case TokenType::GT:
+            return ">";
+        case TokenType::GTE:
+            return ">=";
+        case TokenType::PLUS:
+            return "+";
+        case TokenType::MINUS:
+            return "-";
+        case TokenType::WILDCARD:
+            return "*";
+        case TokenType::SLASH:
+            return "/";
+        case TokenType::LPAREN:
+            return "(";
+        case TokenType::RPAREN:
+            return ")";
+        case TokenType::END_OF_FILE:
+            return "EOF";
+        default:
+            return "";
+        }
+    }
+}
+
+#endif
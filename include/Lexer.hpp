@@ -3,6 +3,10 @@
 
 #include "./Token.hpp"
 #include "./TokenType.hpp"
+#include "./SourceBuffer.hpp"
+#include "./TokenStream.hpp"
+#include "./Keywords.hpp"
+#include "./Scanner.hpp"
 
 #include <iostream>
 #include <memory>
@@ -11,6 +15,7 @@
 #include <map>
 #include <fstream>
 #include <string>
+#include <string_view>
 
 namespace WhileParser
 {
@@ -18,34 +23,93 @@ namespace WhileParser
     class Lexer
     {
     public:
+        // size of the refill buffer of istream sources
+        static constexpr std::size_t DEFAULT_CHUNK_SIZE = 64 * 1024;
+
+        // .wh files are memory mapped and scanned in place
         Lexer(const std::string &filename, bool skip_whitespaces, bool skip_eol);
-        Lexer(std::unique_ptr<std::istream> raw_code, bool skip_whitespaces, bool skip_eol)
+        // fallback for sources that cannot be mapped (pipes, string streams): the stream is read
+        // in chunks, so memory is bounded by the chunk size (or the longest token) and not by the input
+        Lexer(std::unique_ptr<std::istream> raw_code, bool skip_whitespaces, bool skip_eol, std::size_t chunk_size = DEFAULT_CHUNK_SIZE)
+        {
+            init(std::move(raw_code), skip_whitespaces, skip_eol, chunk_size);
+        }
+        // source already in memory, shared with the lexer
+        Lexer(std::shared_ptr<const SourceBuffer> source, bool skip_whitespaces, bool skip_eol)
         {
-            init(std::move(raw_code), skip_whitespaces, skip_eol);
+            init(nullptr, skip_whitespaces, skip_eol, 0);
+            setSource(std::move(source));
+        }
+        // lexes only the characters in [begin, end) of the source, offsets still refer to the whole source
+        Lexer(std::shared_ptr<const SourceBuffer> source, std::size_t begin, std::size_t end, bool skip_whitespaces, bool skip_eol)
+        {
+            init(nullptr, skip_whitespaces, skip_eol, 0);
+            setSource(std::move(source));
+            m_cursor = m_window + begin;
+            m_end = m_window + end;
         }
         ~Lexer() = default;
 
+        // Start over on another source, keeping the options and the refill buffer.
+        // The text of the string_view overload is scanned in place, it has to outlive the tokens
+        void reset(std::shared_ptr<const SourceBuffer> source);
+        void reset(std::unique_ptr<std::istream> raw_code);
+        void reset(std::string_view text);
+
+        // The value of the returned token views the mapped file, so it stays valid as long as the lexer.
+        // For istream sources identifiers and numbers view the chunk buffer, that is refilled,
+        // so their value is only valid until the next call.
         Token nextToken();
 
+        // Lexes all the remaining tokens in one pass, the last one is END_OF_FILE.
+        // An istream (or string_view) source is first copied in memory from the current position, so the
+        // stream can refer to it: the offsets of its tokens are in that copy, that is relative to the text
+        // left by the calls to nextToken(), and not the ones that nextToken() gave.
+        TokenStream tokenizeAll();
+
+        // moves to an offset of an in-memory source (not an istream one): the next token is read from there
+        void seek(std::size_t offset);
+
         bool isTokenAvailable();
         void skipWhitespaces();
         void skipEOL();
 
-        Lexer(const Lexer &other) {}
-        Lexer(const Lexer &&) {}
+        // the buffers are on the heap, so the window and the cursor stay valid in the moved lexer
+        Lexer(Lexer &&) = default;
+        Lexer &operator=(Lexer &&) = default;
+        Lexer(const Lexer &) = delete;
         Lexer &operator=(const Lexer &) = delete;
-        Lexer &&operator=(const Lexer &&) = delete;
 
     private:
-        bool isIdChar(char c) const;
-        Token readIdentifierOrKeyword(char first);
-        Token readNumber(char first);
-        Token readSymbol(char first);
+        Token readIdentifierOrKeyword(const char *start);
+        Token readNumber(const char *start);
+        Token readSymbol(const char *start);
+
+        void init(std::unique_ptr<std::istream> source, bool skip_whitespaces, bool skip_eol, std::size_t chunk_size);
+        void setSource(std::shared_ptr<const SourceBuffer> source);
 
-        void init(std::unique_ptr<std::istream> source, bool skip_whitespaces, bool skip_eol);
+        // Reads the next chunk of an istream source, keeping the characters from token_start on.
+        // token_start and m_cursor are moved with the characters they point to.
+        // Returns false when there is nothing more to read.
+        bool refill(const char *&token_start);
+
+        inline std::size_t tokenOffset(const char *start) const
+        {
+            return m_window_offset + static_cast<std::size_t>(start - m_window);
+        }
 
         std::unique_ptr<std::istream> m_stream;
-        std::unordered_map<std::string, TokenType> m_keywords;
+        std::shared_ptr<const SourceBuffer> m_source;
+        // refill buffer of istream sources
+        std::unique_ptr<char[]> m_chunk;
+        std::size_t m_chunk_size;
+
+        // characters being scanned: the whole mapped file, the viewed text or the current chunk
+        const char *m_window;
+        std::size_t m_window_offset; // offset in the source of the first character of the window
+        const char *m_cursor;
+        const char *m_end;
+
         bool m_skip_whitespaces;
         bool m_skip_eol;
         bool m_eof;
@@ -0,0 +1,40 @@
+#ifndef HH_PARALLEL_LEXER_INCLUDE_GUARD
+#define HH_PARALLEL_LEXER_INCLUDE_GUARD 1
+
+#include "./Lexer.hpp"
+#include "./TokenStream.hpp"
+#include "./SourceBuffer.hpp"
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace WhileParser
+{
+
+    // Lexes a source on several threads.
+    // No token of the language spans a whitespace or a newline, so the source is cut right before
+    // one of them and every piece is lexed independently; the pieces are then merged in order.
+    // The result is identical to Lexer::tokenizeAll over the same source.
+    class ParallelLexer
+    {
+    public:
+        // below this size per thread splitting the source isn't worth the threads
+        static constexpr std::size_t MIN_CHUNK_SIZE = 64 * 1024;
+
+        ParallelLexer(std::shared_ptr<const SourceBuffer> source, bool skip_whitespaces, bool skip_eol, unsigned threads = 0);
+
+        TokenStream tokenizeAll();
+
+        // offsets where the pieces lexed by each thread start, the last one is the size of the source
+        std::vector<std::size_t> splitPoints() const;
+
+    private:
+        std::shared_ptr<const SourceBuffer> m_source;
+        bool m_skip_whitespaces;
+        bool m_skip_eol;
+        unsigned m_threads;
+    };
+}
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef HH_PARALLEL_PARSER_INCLUDE_GUARD
+#define HH_PARALLEL_PARSER_INCLUDE_GUARD 1
+
+#include "./AST.hpp"
+#include "./Parser.hpp"
+#include "./TokenStream.hpp"
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace WhileParser
+{
+
+    // Parses the top level statements of a token stream on several threads.
+    // A pre-scan of the token types (if/while against endif/endwhile, and ; and skip out of them)
+    // finds where top level statements end, the stream is cut there and every piece is parsed
+    // independently; the statements are then added to the RootNode in order.
+    // The tree is identical to Parser::parse over the same tokens, and so is the error thrown,
+    // that is the one of the first piece that has one.
+    class ParallelParser
+    {
+    public:
+        // below this number of tokens per thread splitting the stream isn't worth the threads
+        static constexpr std::size_t MIN_PIECE_TOKENS = 16 * 1024;
+
+        // the stream isn't copied, it has to outlive the parser
+        ParallelParser(const TokenStream &tokens, unsigned threads = 0);
+
+        std::unique_ptr<RootNode> parse();
+
+        // used by the parsers of the pieces
+        inline void setParseMode(ParseMode mode)
+        {
+            m_mode = mode;
+        }
+
+        // indices of the tokens where the pieces parsed by each thread start, the last one is the
+        // index of END_OF_FILE
+        std::vector<std::size_t> splitPoints() const;
+
+    private:
+        const TokenStream &m_tokens;
+        unsigned m_threads;
+        ParseMode m_mode;
+    };
+}
+
+#endif
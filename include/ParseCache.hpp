@@ -0,0 +1,82 @@
+#ifndef HH_PARSE_CACHE_INCLUDE_GUARD
+#define HH_PARSE_CACHE_INCLUDE_GUARD 1
+
+#include "./AST.hpp"
+#include "./FlatAST.hpp"
+#include "./SourceBuffer.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace WhileParser
+{
+
+    // On-disk cache of parsed programs, keyed by a hash of the source bytes and the grammar version.
+    // Entries are saved FlatASTs, written to a temporary file and renamed in place, so processes
+    // sharing the directory never see a partial entry and read it without locks. The least recently
+    // used entries (by modification time, refreshed at every hit) are evicted above max_bytes.
+    class ParseCache
+    {
+    public:
+        // bumped at every change of the trees built by the parser, the old entries are then ignored
+        static constexpr std::uint32_t GRAMMAR_VERSION = 2;
+        static constexpr std::uintmax_t DEFAULT_MAX_BYTES = 256u << 20;
+
+        // creates the directory if it doesn't exist
+        ParseCache(const std::string &directory, std::uintmax_t max_bytes = DEFAULT_MAX_BYTES);
+
+        // the tree of a .wh file: built from the cache if the same bytes were parsed before,
+        // otherwise parsed (throwing at the first error as Parser::parse) and stored
+        std::unique_ptr<RootNode> parse(const std::string &filename);
+
+        // same as parse(), but a hit is the mapped entry itself, no node is built
+        FlatAST parseFlat(const std::string &filename);
+
+        // maps a .wh file, with the checks of Parser(filename)
+        static std::shared_ptr<const SourceBuffer> openSource(const std::string &filename);
+
+        // name of the entry of a source in the directory
+        static std::string keyOf(std::string_view source);
+
+        // the entry of a key, if it's there and valid
+        std::optional<FlatAST> find(const std::string &key);
+
+        // I/O errors are ignored: the cache is only a shortcut
+        void store(const std::string &key, const FlatAST &flat);
+
+        // counts the entries and, above max_bytes, removes the least recently used ones
+        // until the cache is under 3/4 of it
+        void evict();
+
+        inline std::size_t getHits() const
+        {
+            return m_hits;
+        }
+
+        inline std::size_t getMisses() const
+        {
+            return m_misses;
+        }
+
+    private:
+        std::filesystem::path m_directory;
+        std::uintmax_t m_max_bytes;
+        std::atomic<std::size_t> m_hits;
+        std::atomic<std::size_t> m_misses;
+
+        // only the writers lock: the size of the directory, counted at the first store and
+        // then kept up to date with the entries of this process
+        std::mutex m_mutex;
+        std::optional<std::uintmax_t> m_bytes;
+        std::size_t m_temporaries;
+    };
+}
+
+#endif
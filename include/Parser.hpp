@@ -5,30 +5,198 @@
 #include "./AST.hpp"
 #include "./Lexer.hpp"
 #include "./TokenType.hpp"
+#include "./TokenStream.hpp"
+#include "./SubtreeTable.hpp"
+#include "./SymbolTable.hpp"
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
 
 namespace WhileParser
 {
 
+    // How the parser walks the grammar: with one function per production, or with the same
+    // productions driven by an explicit stack, that doesn't overflow on deeply nested programs
+    enum class ParseMode
+    {
+        RECURSIVE_DESCENT,
+        EXPLICIT_STACK
+    };
+
+    // A syntax error found by Parser::parseWithDiagnostics
+    struct Diagnostic
+    {
+        std::string message;
+        std::size_t offset; // of the token where the error was found
+    };
+
+    // Result of Parser::parseWithDiagnostics: all the errors of the program and,
+    // only if there were none, its tree
+    struct ParseResult
+    {
+        std::unique_ptr<RootNode> root;
+        std::vector<Diagnostic> diagnostics;
+
+        inline bool ok() const
+        {
+            return diagnostics.empty();
+        }
+    };
+
+    class IncrementalParser;
+
     class Parser
     {
     public:
         Parser(const std::string &filename) : m_lexer(filename, true, true),
-                                              m_current_token(Token(TokenType::END_OF_FILE, "EOF"))
+                                              m_current_token(Token(TokenType::END_OF_FILE, "EOF")),
+                                              m_tokens(nullptr), m_next_token(0), m_mode(ParseMode::RECURSIVE_DESCENT), m_diagnostics(nullptr), m_panic(false), m_open_blocks(0), m_hash_consing(false), m_incremental(nullptr), m_previous_end(0), m_symbols(std::make_shared<SymbolTable>())
         {
-            advance(); // get the first token
+            nextToken(); // get the first token, it's checked by parse()
         }
 
         Parser(std::unique_ptr<std::istream> raw_code) : m_lexer(std::move(raw_code), true, true),
-                                                         m_current_token(Token(TokenType::END_OF_FILE, "EOF"))
+                                                         m_current_token(Token(TokenType::END_OF_FILE, "EOF")),
+                                                         m_tokens(nullptr), m_next_token(0), m_mode(ParseMode::RECURSIVE_DESCENT), m_diagnostics(nullptr), m_panic(false), m_open_blocks(0), m_hash_consing(false), m_incremental(nullptr), m_previous_end(0), m_symbols(std::make_shared<SymbolTable>())
+        {
+            nextToken();
+        }
+
+        // parses tokens that were already produced by Lexer::tokenizeAll, walking them by index.
+        // The stream isn't copied, it has to outlive the parser.
+        Parser(const TokenStream &tokens) : m_lexer(tokens.getSource(), true, true),
+                                            m_current_token(Token(TokenType::END_OF_FILE, "EOF")),
+                                            m_tokens(&tokens), m_next_token(0), m_mode(ParseMode::RECURSIVE_DESCENT), m_diagnostics(nullptr), m_panic(false), m_open_blocks(0), m_hash_consing(false), m_incremental(nullptr), m_previous_end(0), m_symbols(std::make_shared<SymbolTable>())
+        {
+            nextToken();
+        }
+
+        // parses an in-memory source from the offset begin, that has to be the start of a token.
+        // The offsets of the tokens (and of the diagnostics) are the ones in the whole source
+        Parser(const std::shared_ptr<const SourceBuffer> &source, std::size_t begin = 0) : m_lexer(source, begin, source->size(), true, true),
+                                                                                           m_current_token(Token(TokenType::END_OF_FILE, "EOF")),
+                                                                                           m_tokens(nullptr), m_next_token(0), m_mode(ParseMode::RECURSIVE_DESCENT), m_diagnostics(nullptr), m_panic(false), m_open_blocks(0), m_hash_consing(false), m_incremental(nullptr), m_previous_end(0), m_symbols(std::make_shared<SymbolTable>())
         {
-            advance();
+            nextToken();
         }
 
+        // a parser is moved with its buffers, and it can't be copied
+        Parser(Parser &&) = default;
+        Parser &operator=(Parser &&) = default;
+
+        // Start over on another program, as if the parser was constructed on it, but keeping the parse
+        // mode and every buffer (the lexer chunk, the explicit stack, the hash consing table).
+        // The text of the string_view overload is scanned in place, it has to outlive the tree
+        void reset(const std::shared_ptr<const SourceBuffer> &source);
+        void reset(std::unique_ptr<std::istream> raw_code);
+        void reset(const TokenStream &tokens);
+        void reset(std::string_view text);
+
         std::unique_ptr<RootNode> parse();
 
+        // same as parse(), but every top level statement is passed to the callback as soon as it's parsed
+        // and destroyed when the callback returns. With a file or a stream, memory is then bounded by the
+        // biggest statement and not by the program. Returns the number of statements
+        std::size_t parseEach(const std::function<void(const StatementNode &)> &callback);
+
+        // same as parse(), but syntax errors are not thrown: each one is recorded and the parser skips
+        // the statement where it was found (up to its ';', or its endif/endwhile), then goes on.
+        // An if or while with an error in one of its statements is parsed to its end and left out too,
+        // the parser never builds a node with a missing child. So all the errors come out of one pass
+        ParseResult parseWithDiagnostics();
+
+        // same as parse(), but the nodes and their text are bump allocated in an arena owned by the tree.
+        // With hash consing identical expression and predicate subtrees are built once and shared,
+        // so the tree is a DAG and comparing two shared subtrees is immediate
+        ArenaTree parseInArena(bool hash_consing = false);
+
+        // identifiers of the program being parsed, the slots of its variables index them.
+        // It's the table of the trees built from the program (RootNode::getSymbols), and the one
+        // of the statements passed by parseEach()
+        inline std::shared_ptr<const SymbolTable> getSymbols() const
+        {
+            return m_symbols;
+        }
+
+        // used by parse() and parseInArena(), the trees built are the same in both modes
+        inline void setParseMode(ParseMode mode)
+        {
+            m_mode = mode;
+        }
+
+        inline ParseMode getParseMode() const
+        {
+            return m_mode;
+        }
+
     private:
-        // Statement parsing
+        // drives parseStatement() to reparse the statements touched by an edit
+        friend class IncrementalParser;
+        // drives parseStatement() over a piece of the token stream
+        friend class ParallelParser;
+
+        // Steps of the explicit stack mode: the part of a production that follows one of its
+        // nonterminals, that is what the recursive descent does after a call returns
+        enum class Step : std::uint8_t
+        {
+            STATEMENT,
+            STATEMENT_END,
+            ASSIGNMENT_END,
+            IF_THEN,
+            IF_ELSE,
+            IF_END,
+            WHILE_DO,
+            WHILE_END,
+            EXPRESSION,
+            EXPRESSION_OPERATOR,
+            EXPRESSION_REDUCE,
+            MUL_DIV_EXPRESSION,
+            MUL_DIV_OPERATOR,
+            MUL_DIV_REDUCE,
+            PRIMARY_EXPRESSION,
+            PRIMARY_EXPRESSION_END,
+            PREDICATE,
+            OR_OPERATOR,
+            OR_REDUCE,
+            AND_PREDICATE,
+            AND_OPERATOR,
+            AND_REDUCE,
+            UNARY_PREDICATE,
+            NOT_REDUCE,
+            PRIMARY_PREDICATE_END,
+            RELATIONAL_OPERATOR,
+            RELATIONAL_REDUCE
+        };
+
+        struct Frame
+        {
+            Step step;
+            TokenType op = TokenType::UNKNOWN; // operator of the *_REDUCE steps
+            std::uint32_t slot = 0;            // of the variable of ASSIGNMENT_END
+        };
+
+        // what the stacks looked like when a statement started, to drop what it left there if it fails
+        struct StatementMark
+        {
+            std::size_t values;
+            std::size_t open_blocks;
+        };
+
+        // parses the top level statements one after the other, handing each one to the sink
+        void parseStatements(const std::function<void(std::unique_ptr<StatementNode>)> &sink);
+
+        // explicit stack mode: the same grammar as parseStatement() and below
+        std::unique_ptr<StatementNode> parseStatementWithStack();
+        void runSteps();
+        void recoverSteps();
+
+        // Statement parsing: parseStatement() recovers from the errors of the statement
         std::unique_ptr<StatementNode> parseStatement();
+        std::unique_ptr<StatementNode> dispatchStatement();
 
         std::unique_ptr<AssignmentNode> parseAssignmentStatement();
         std::unique_ptr<IfNode> parseIfStatement();
@@ -48,12 +216,69 @@ namespace WhileParser
         std::unique_ptr<PredicateNode> parseBooleanPredicate();
         std::unique_ptr<RelationalPredicateNode> parseRelationalPredicate();
 
+        // Node construction, shared through m_subtrees when hash consing
+        std::unique_ptr<ExpressionNode> makeTerminalExpression(const Token &terminal);
+        std::unique_ptr<ExpressionNode> makeMathExpression(TokenType op, std::unique_ptr<ExpressionNode> left, std::unique_ptr<ExpressionNode> right);
+        std::unique_ptr<PredicateNode> makePredicate(TokenType constant);
+        std::unique_ptr<PredicateNode> makeNotPredicate(std::unique_ptr<PredicateNode> predicate);
+        std::unique_ptr<PredicateNode> makeBooleanPredicate(TokenType op, std::unique_ptr<PredicateNode> left, std::unique_ptr<PredicateNode> right);
+        std::unique_ptr<RelationalPredicateNode> makeRelationalPredicate(TokenType op, std::unique_ptr<ExpressionNode> left,
+                                                                         std::unique_ptr<ExpressionNode> right);
+
+        // returns the node of m_subtrees with that hash and kind that matches, or makes and records a new one
+        template <typename T, typename Matches, typename Make>
+        std::unique_ptr<T> intern(std::uint64_t hash, NodeKind kind, Matches matches, Make make);
+
         // i encapsulate the check of token validity in here
         void advance();
-        Token consume(TokenType expected, const std::string &errorMessage);
+        void nextToken();
+        void skipUnknownTokens();
+        // clears the state of the last parse and reads the first token of the new source
+        void restart();
+        // moves past text that is not parsed again, to the token that starts at offset
+        void seek(std::size_t offset);
+        // false (with a diagnostic recorded) if the token is not the expected one
+        bool consume(TokenType expected, const char *errorMessage);
+
+        // Errors: thrown as std::invalid_argument, or recorded when collecting diagnostics.
+        // A syntax error also puts the parser in panic mode: the productions return nullptr
+        // up to the statement, that skips its remaining tokens with recover()
+        void report(std::string message);
+        void error(std::string message);
+        void recover(std::size_t open_blocks);
 
         Lexer m_lexer;
         Token m_current_token; // lookahead (1)
+
+        // token stream mode: the lexer is not used
+        const TokenStream *m_tokens;
+        std::size_t m_next_token;
+
+        ParseMode m_mode;
+        // explicit stack mode: the steps to run and the nodes built and not yet attached to their
+        // parent. They are kept between statements to reuse their memory
+        std::vector<Frame> m_frames;
+        std::vector<std::unique_ptr<ASTNode>> m_values;
+        std::vector<StatementMark> m_statements;
+
+        // diagnostics mode: where errors go (nullptr when they are thrown), whether the parser is
+        // in panic mode, and how many if/while are open, i.e. whose endif/endwhile is still to come
+        std::vector<Diagnostic> *m_diagnostics;
+        bool m_panic;
+        std::size_t m_open_blocks;
+
+        // hash consing: the subtrees built so far, by structural hash
+        bool m_hash_consing;
+        SubtreeTable m_subtrees;
+
+        // incremental mode: the parser that reuses the old statements, and the end of the last
+        // token moved past, that is of the text parsed so far
+        IncrementalParser *m_incremental;
+        std::size_t m_previous_end;
+
+        // identifiers of the program, interned as the nodes that name them are built.
+        // Shared with the trees, whose variables view their names in it
+        std::shared_ptr<SymbolTable> m_symbols;
     };
 
 }
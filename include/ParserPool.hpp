@@ -0,0 +1,48 @@
+#ifndef HH_PARSER_POOL_INCLUDE_GUARD
+#define HH_PARSER_POOL_INCLUDE_GUARD 1
+
+#include "./Parser.hpp"
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace WhileParser
+{
+
+    // Parsers kept warm to parse many small programs: a leased parser is reset() on the next
+    // program, so its buffers are reused instead of being allocated again.
+    // acquire() can be called from any thread, every lease is used by one thread at a time.
+    class ParserPool
+    {
+    public:
+        // gives the parser back to the pool when the lease is destroyed
+        struct Release
+        {
+            ParserPool *pool;
+            void operator()(Parser *parser) const;
+        };
+        using Lease = std::unique_ptr<Parser, Release>;
+
+        ParserPool(ParseMode mode = ParseMode::RECURSIVE_DESCENT) : m_mode(mode) {}
+
+        ParserPool(const ParserPool &) = delete;
+        ParserPool &operator=(const ParserPool &) = delete;
+
+        // an idle parser, or a new one if there is none. It has an empty program until it's reset
+        Lease acquire();
+
+        // parsers that are not leased
+        std::size_t idle();
+
+    private:
+        void release(Parser *parser);
+
+        ParseMode m_mode;
+        std::mutex m_mutex;
+        std::vector<std::unique_ptr<Parser>> m_idle;
+    };
+}
+
+#endif
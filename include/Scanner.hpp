@@ -0,0 +1,75 @@
+#ifndef HH_SCANNER_INCLUDE_GUARD
+#define HH_SCANNER_INCLUDE_GUARD 1
+
+#include <array>
+#include <cstdint>
+#include <span>
+
+namespace WhileParser
+{
+    // Character classes of the language, looked up in a table instead of the locale-aware <cctype> calls
+    enum CharClass : std::uint8_t
+    {
+        CHAR_DIGIT = 1 << 0,
+        CHAR_ALPHA = 1 << 1,
+        CHAR_UNDERSCORE = 1 << 2,
+        CHAR_SPACE = 1 << 3,
+        CHAR_NEWLINE = 1 << 4,
+
+        CHAR_IDENTIFIER_START = CHAR_ALPHA | CHAR_UNDERSCORE,
+        CHAR_IDENTIFIER = CHAR_ALPHA | CHAR_UNDERSCORE | CHAR_DIGIT
+    };
+
+    constexpr std::array<std::uint8_t, 256> makeCharClasses()
+    {
+        std::array<std::uint8_t, 256> classes{};
+        for (int c = '0'; c <= '9'; ++c)
+            classes[c] = CHAR_DIGIT;
+        for (int c = 'a'; c <= 'z'; ++c)
+            classes[c] = CHAR_ALPHA;
+        for (int c = 'A'; c <= 'Z'; ++c)
+            classes[c] = CHAR_ALPHA;
+        classes['_'] = CHAR_UNDERSCORE;
+        classes[' '] = CHAR_SPACE;
+        classes['\n'] = CHAR_NEWLINE;
+        return classes;
+    }
+
+    inline constexpr std::array<std::uint8_t, 256> CHAR_CLASSES = makeCharClasses();
+
+    constexpr bool hasCharClass(char c, std::uint8_t char_class)
+    {
+        return (CHAR_CLASSES[static_cast<unsigned char>(c)] & char_class) != 0;
+    }
+
+    // Scanning kernels over a contiguous buffer: each returns the first character in [begin, end)
+    // that doesn't belong to the run, or end. They process 16 (SSE2) or 32 (AVX2) bytes at a time,
+    // the implementation is picked on first use from the features of the CPU.
+    const char *scanIdentifier(const char *begin, const char *end);
+    const char *scanDigits(const char *begin, const char *end);
+    const char *scanBlanks(const char *begin, const char *end, bool spaces, bool newlines);
+
+    // name of the kernels in use: "avx2", "sse2" or "scalar"
+    const char *scannerImplementation();
+
+    // One implementation of the three kernels above
+    struct ScanKernels
+    {
+        const char *name;
+        const char *(*identifier)(const char *begin, const char *end);
+        const char *(*digits)(const char *begin, const char *end);
+        const char *(*blanks)(const char *begin, const char *end, bool spaces, bool newlines);
+    };
+
+    // the implementations the CPU can run, the one in use first and the scalar one last
+    std::span<const ScanKernels> supportedScanKernels();
+
+    // value of a number that doesn't fit in 64 bits: the naturals of the language are never negative
+    inline constexpr std::int64_t NUMBER_OVERFLOW = -1;
+
+    // value of the run of decimal digits [begin, end), converted 8 digits at a time,
+    // or NUMBER_OVERFLOW if it's above INT64_MAX
+    std::int64_t parseNumber(const char *begin, const char *end);
+}
+
+#endif
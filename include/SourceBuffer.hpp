@@ -0,0 +1,59 @@
+#ifndef HH_SOURCE_BUFFER_INCLUDE_GUARD
+#define HH_SOURCE_BUFFER_INCLUDE_GUARD 1
+
+#include <cstddef>
+#include <istream>
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace WhileParser
+{
+
+    // Read-only, contiguous view of a whole program.
+    // Files are memory mapped so the lexer can scan them without copying
+    // (the ones that are not regular files, e.g. pipes, are read in a buffer).
+    class SourceBuffer
+    {
+    public:
+        static std::unique_ptr<SourceBuffer> map(const std::string &filename);
+        // sources that can't be mapped are copied in a buffer owned by the SourceBuffer
+        static std::unique_ptr<SourceBuffer> fromString(std::string text);
+        static std::unique_ptr<SourceBuffer> fromStream(std::istream &stream);
+
+        ~SourceBuffer();
+
+        SourceBuffer(const SourceBuffer &) = delete;
+        SourceBuffer &operator=(const SourceBuffer &) = delete;
+
+        inline const char *begin() const
+        {
+            return m_data;
+        }
+
+        inline const char *end() const
+        {
+            return m_data + m_size;
+        }
+
+        inline std::size_t size() const
+        {
+            return m_size;
+        }
+
+        inline std::string_view text() const
+        {
+            return std::string_view(m_data, m_size);
+        }
+
+    private:
+        SourceBuffer(const char *data, std::size_t size, bool mapped) : m_data(data), m_size(size), m_mapped(mapped) {}
+
+        const char *m_data;
+        std::size_t m_size;
+        bool m_mapped;
+        std::string m_owned;
+    };
+}
+
+#endif
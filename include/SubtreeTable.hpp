@@ -0,0 +1,80 @@
+#ifndef HH_SUBTREE_TABLE_INCLUDE_GUARD
+#define HH_SUBTREE_TABLE_INCLUDE_GUARD 1
+
+#include "./AST.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace WhileParser
+{
+
+    // Set of AST nodes keyed by their structural hash, used for hash consing.
+    // Open addressing with linear probing: the hash is stored in the nodes, so a slot is just a pointer.
+    class SubtreeTable
+    {
+    public:
+        SubtreeTable() : m_slots(), m_size(0) {}
+
+        inline void clear()
+        {
+            m_slots.clear();
+            m_size = 0;
+        }
+
+        inline std::size_t size() const
+        {
+            return m_size;
+        }
+
+        // first node with that hash for which matches(node) is true, nullptr if there is none
+        template <typename Matches>
+        inline ASTNode *find(std::uint64_t hash, Matches matches) const
+        {
+            if (m_slots.empty())
+                return nullptr;
+
+            std::size_t mask = m_slots.size() - 1;
+            for (std::size_t slot = hash & mask; m_slots[slot] != nullptr; slot = (slot + 1) & mask)
+            {
+                if (m_slots[slot]->getHash() == hash && matches(*m_slots[slot]))
+                    return m_slots[slot];
+            }
+            return nullptr;
+        }
+
+        inline void insert(ASTNode *node)
+        {
+            // at most half full
+            if ((m_size + 1) * 2 > m_slots.size())
+                grow();
+            place(m_slots, node);
+            ++m_size;
+        }
+
+    private:
+        static inline void place(std::vector<ASTNode *> &slots, ASTNode *node)
+        {
+            std::size_t mask = slots.size() - 1;
+            std::size_t slot = node->getHash() & mask;
+            while (slots[slot] != nullptr)
+                slot = (slot + 1) & mask;
+            slots[slot] = node;
+        }
+
+        inline void grow()
+        {
+            std::vector<ASTNode *> slots(m_slots.empty() ? 1024 : m_slots.size() * 2, nullptr);
+            for (ASTNode *node : m_slots)
+                if (node)
+                    place(slots, node);
+            m_slots.swap(slots);
+        }
+
+        std::vector<ASTNode *> m_slots;
+        std::size_t m_size;
+    };
+}
+
+#endif
@@ -0,0 +1,143 @@
+#ifndef HH_SYMBOL_TABLE_INCLUDE_GUARD
+#define HH_SYMBOL_TABLE_INCLUDE_GUARD 1
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+namespace WhileParser
+{
+
+    // Identifiers of a program, each stored once and numbered in order of appearance: the slot of a
+    // variable is a dense index, so an environment can be an array indexed by it, and two identifiers
+    // of the same program are the same if their slots are.
+    // Open addressing with linear probing on the slots; the names are copied in blocks that never
+    // move, so the views handed out stay valid as the table grows, up to clear().
+    // Looking up a name that is already in the table doesn't modify it.
+    class SymbolTable
+    {
+    public:
+        // slot of an identifier that is not in any table
+        static constexpr std::uint32_t NO_SLOT = UINT32_MAX;
+
+        SymbolTable() : m_names(), m_buckets(), m_blocks(), m_block(0), m_block_used(0) {}
+
+        // the views of the names point into the table, it can't be copied
+        SymbolTable(const SymbolTable &) = delete;
+        SymbolTable &operator=(const SymbolTable &) = delete;
+
+        // slot of the name, added at the end if it's not in the table yet
+        inline std::uint32_t intern(std::string_view name)
+        {
+            std::uint32_t slot = find(name);
+            if (slot != NO_SLOT)
+                return slot;
+
+            // at most half full
+            if ((m_names.size() + 1) * 2 > m_buckets.size())
+                grow();
+            slot = static_cast<std::uint32_t>(m_names.size());
+            m_names.push_back(copy(name));
+            place(m_buckets, m_names.back(), slot);
+            return slot;
+        }
+
+        // slot of the name, NO_SLOT if it's not in the table
+        inline std::uint32_t find(std::string_view name) const
+        {
+            if (m_buckets.empty())
+                return NO_SLOT;
+
+            std::size_t mask = m_buckets.size() - 1;
+            for (std::size_t bucket = hash(name) & mask; m_buckets[bucket] != NO_SLOT; bucket = (bucket + 1) & mask)
+            {
+                if (m_names[m_buckets[bucket]] == name)
+                    return m_buckets[bucket];
+            }
+            return NO_SLOT;
+        }
+
+        inline std::string_view getName(std::uint32_t slot) const
+        {
+            return m_names[slot];
+        }
+
+        // number of identifiers, the slots go from 0 to size() - 1
+        inline std::size_t size() const
+        {
+            return m_names.size();
+        }
+
+        // empties the table keeping its memory, the views handed out so far are no longer valid
+        inline void clear()
+        {
+            m_names.clear();
+            std::fill(m_buckets.begin(), m_buckets.end(), NO_SLOT);
+            m_block = 0;
+            m_block_used = 0;
+        }
+
+    private:
+        static constexpr std::size_t BLOCK_SIZE = 4096;
+
+        struct Block
+        {
+            std::unique_ptr<char[]> text;
+            std::size_t size;
+        };
+
+        static inline std::size_t hash(std::string_view name)
+        {
+            return std::hash<std::string_view>{}(name);
+        }
+
+        // copies the name at the end of the current block, or in the next one that fits it
+        inline std::string_view copy(std::string_view name)
+        {
+            while (m_block < m_blocks.size() && m_block_used + name.size() > m_blocks[m_block].size)
+            {
+                ++m_block;
+                m_block_used = 0;
+            }
+            if (m_block == m_blocks.size())
+            {
+                std::size_t size = std::max(BLOCK_SIZE, name.size());
+                m_blocks.push_back({std::make_unique<char[]>(size), size});
+            }
+
+            char *text = m_blocks[m_block].text.get() + m_block_used;
+            std::copy(name.begin(), name.end(), text);
+            m_block_used += name.size();
+            return std::string_view(text, name.size());
+        }
+
+        static inline void place(std::vector<std::uint32_t> &buckets, std::string_view name, std::uint32_t slot)
+        {
+            std::size_t mask = buckets.size() - 1;
+            std::size_t bucket = hash(name) & mask;
+            while (buckets[bucket] != NO_SLOT)
+                bucket = (bucket + 1) & mask;
+            buckets[bucket] = slot;
+        }
+
+        inline void grow()
+        {
+            std::vector<std::uint32_t> buckets(m_buckets.empty() ? 64 : m_buckets.size() * 2, NO_SLOT);
+            for (std::uint32_t slot = 0; slot < m_names.size(); ++slot)
+                place(buckets, m_names[slot], slot);
+            m_buckets.swap(buckets);
+        }
+
+        std::vector<std::string_view> m_names; // by slot
+        std::vector<std::uint32_t> m_buckets;  // slots, NO_SLOT if empty
+        std::vector<Block> m_blocks;
+        std::size_t m_block; // where the next name is copied
+        std::size_t m_block_used;
+    };
+}
+
+#endif
@@ -2,27 +2,47 @@
 #define HH_TOKEN_INCLUDE_GUARD 1
 
 #include "./TokenType.hpp"
+#include "./Scanner.hpp"
+#include <cstddef>
+#include <cstdint>
 #include <string>
+#include <string_view>
 
 namespace WhileParser
 {
 
+    // A token doesn't own its lexeme: the value is a view into the source buffer
+    // (or into the lexer for streamed sources), so copying a token never allocates.
+    // A NUMBER also carries its value, converted once by the lexer.
     class Token
     {
     public:
-        Token(TokenType type, const std::string &value) : m_token_type(type), m_value(value) {}
+        Token(TokenType type, std::string_view value, std::size_t offset = 0, std::int64_t number = 0)
+            : m_token_type(type), m_value(value), m_offset(offset), m_number(number) {}
 
-        inline TokenType getType()
+        inline TokenType getType() const
         {
             return m_token_type;
         }
 
-        inline const std::string &getValue()
+        inline std::string_view getValue() const
         {
             return m_value;
         }
 
-        inline const std::string getTokenTypeString()
+        // position of the first character of the token in the source
+        inline std::size_t getOffset() const
+        {
+            return m_offset;
+        }
+
+        // value of a NUMBER, NUMBER_OVERFLOW if it doesn't fit in 64 bits (the digits are still the value)
+        inline std::int64_t getNumber() const
+        {
+            return m_number;
+        }
+
+        inline const std::string getTokenTypeString() const
         {
 
             switch (m_token_type)
@@ -99,7 +119,9 @@ namespace WhileParser
 
     private:
         TokenType m_token_type;
-        std::string m_value;
+        std::string_view m_value;
+        std::size_t m_offset;
+        std::int64_t m_number;
     };
 }
 
@@ -0,0 +1,102 @@
+#ifndef HH_TOKEN_STREAM_INCLUDE_GUARD
+#define HH_TOKEN_STREAM_INCLUDE_GUARD 1
+
+#include "./Token.hpp"
+#include "./TokenType.hpp"
+#include "./SourceBuffer.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+namespace WhileParser
+{
+
+    // All the tokens of a source, stored as a struct of arrays.
+    // Offsets refer to the source buffer, that the stream keeps alive, so a program can be
+    // tokenized once and parsed many times.
+    class TokenStream
+    {
+    public:
+        TokenStream(std::shared_ptr<const SourceBuffer> source) : m_source(std::move(source)) {}
+
+        inline std::size_t size() const
+        {
+            return m_types.size();
+        }
+
+        inline TokenType getType(std::size_t idx) const
+        {
+            return m_types[idx];
+        }
+
+        inline std::size_t getOffset(std::size_t idx) const
+        {
+            return m_offsets[idx];
+        }
+
+        inline std::uint32_t getLength(std::size_t idx) const
+        {
+            return m_lengths[idx];
+        }
+
+        inline std::string_view getValue(std::size_t idx) const
+        {
+            // the end of file has no lexeme in the source
+            if (m_types[idx] == TokenType::END_OF_FILE)
+                return "EOF";
+            return std::string_view(m_source->begin() + m_offsets[idx], m_lengths[idx]);
+        }
+
+        // the value of a NUMBER is converted here, the stream only keeps the lexemes
+        inline Token getToken(std::size_t idx) const
+        {
+            std::string_view value = getValue(idx);
+            if (m_types[idx] == TokenType::NUMBER)
+                return Token(m_types[idx], value, m_offsets[idx], parseNumber(value.data(), value.data() + value.size()));
+            return Token(m_types[idx], value, m_offsets[idx]);
+        }
+
+        inline const std::shared_ptr<const SourceBuffer> &getSource() const
+        {
+            return m_source;
+        }
+
+        inline const std::vector<TokenType> &getTypes() const
+        {
+            return m_types;
+        }
+
+        inline void push(TokenType type, std::size_t offset, std::uint32_t length)
+        {
+            m_types.push_back(type);
+            m_offsets.push_back(offset);
+            m_lengths.push_back(length);
+        }
+
+        // appends the tokens in [first, last) of another stream over the same source
+        inline void append(const TokenStream &other, std::size_t first, std::size_t last)
+        {
+            m_types.insert(m_types.end(), other.m_types.begin() + first, other.m_types.begin() + last);
+            m_offsets.insert(m_offsets.end(), other.m_offsets.begin() + first, other.m_offsets.begin() + last);
+            m_lengths.insert(m_lengths.end(), other.m_lengths.begin() + first, other.m_lengths.begin() + last);
+        }
+
+        inline void reserve(std::size_t tokens)
+        {
+            m_types.reserve(tokens);
+            m_offsets.reserve(tokens);
+            m_lengths.reserve(tokens);
+        }
+
+    private:
+        std::shared_ptr<const SourceBuffer> m_source;
+        std::vector<TokenType> m_types;
+        std::vector<std::size_t> m_offsets;
+        std::vector<std::uint32_t> m_lengths;
+    };
+}
+
+#endif
@@ -1,9 +1,11 @@
 #ifndef HH_TOKEN_TYPE_INCLUDE_GUARD
 #define HH_TOKEN_TYPE_INCLUDE_GUARD 1
 
+#include <cstdint>
+
 namespace WhileParser
 {
-    enum class TokenType
+    enum class TokenType : std::uint8_t
     {
         UNKNOWN,
         IDENTIFIER,
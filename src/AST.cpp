@@ -0,0 +1,359 @@
+#include "../include/AST.hpp"
+
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+namespace WhileParser
+{
+    namespace
+    {
+        // subtrees waiting to be destroyed, see ~ASTNode
+        thread_local std::vector<std::unique_ptr<ASTNode>> t_pending;
+        thread_local bool t_destroying = false;
+
+        // Writes the outline of printNode: a line is prefixed by "|   " for each level but the
+        // last one, that is "|-- ". The bars are kept in one string, so a line is written with
+        // a single call however deep it is.
+        class TreePrinter
+        {
+        public:
+            TreePrinter(std::ostream &out) : m_out(out) {}
+
+            void print(const ASTNode *root, int indent)
+            {
+                m_stack.push_back({root, {}, indent});
+
+                while (!m_stack.empty())
+                {
+                    Item item = m_stack.back();
+                    m_stack.pop_back();
+
+                    if (item.node)
+                        printNode(*item.node, item.indent);
+                    else
+                        line(item.label, item.indent);
+                }
+                m_out.flush();
+            }
+
+        private:
+            // a node to print, or a label line (node is null) between the children of a node
+            struct Item
+            {
+                const ASTNode *node;
+                std::string_view label;
+                int indent;
+            };
+
+            void prefix(int indent)
+            {
+                if (indent <= 0)
+                    return;
+
+                std::size_t bars = static_cast<std::size_t>(indent - 1) * 4;
+                while (m_bars.size() < bars)
+                    m_bars += "|   ";
+                m_out.write(m_bars.data(), static_cast<std::streamsize>(bars));
+                m_out.write("|-- ", 4);
+            }
+
+            void line(std::string_view text, int indent)
+            {
+                prefix(indent);
+                m_out << text << '\n';
+            }
+
+            // what follows the first child is pushed in reverse order, to be printed after its subtree
+            void push(const ASTNode *node, int indent)
+            {
+                if (node)
+                    m_stack.push_back({node, {}, indent});
+            }
+
+            void push(std::string_view label, int indent)
+            {
+                m_stack.push_back({nullptr, label, indent});
+            }
+
+            void printNode(const ASTNode &node, int indent)
+            {
+                switch (node.getKind())
+                {
+                case NodeKind::ROOT:
+                {
+                    // the root is always at the top of the outline
+                    line("RootNode", 0);
+                    const auto &children = static_cast<const RootNode &>(node).getChildren();
+                    for (std::size_t idx = children.size(); idx-- > 0;)
+                        push(children[idx].get(), 1);
+                    break;
+                }
+                case NodeKind::NUMBER_LITERAL:
+                    line("NumberLiteralNode", indent);
+                    line(static_cast<const NumberLiteralNode &>(node).toString(), indent + 2);
+                    break;
+                case NodeKind::VARIABLE_REF:
+                    line("VariableRefNode", indent);
+                    line(static_cast<const VariableRefNode &>(node).getName(), indent + 2);
+                    break;
+                case NodeKind::PREDICATE:
+                    line("PredicateNode", indent);
+                    line(static_cast<const PredicateNode &>(node).getTerminalPredicate(), indent + 2);
+                    break;
+                case NodeKind::ASSIGNMENT:
+                {
+                    auto &assignment = static_cast<const AssignmentNode &>(node);
+                    line("AssignmentNode", indent);
+                    line("Identifier", indent + 1);
+                    line(assignment.getVariableName(), indent + 2);
+                    line("Expression", indent + 1);
+                    push(assignment.getExpression(), indent + 2);
+                    break;
+                }
+                case NodeKind::IF:
+                {
+                    auto &if_node = static_cast<const IfNode &>(node);
+                    line("IfNode", indent);
+                    line("Condition", indent + 1);
+                    push(if_node.getElseBranch(), indent + 2);
+                    push("ElseBranch", indent + 1);
+                    push(if_node.getThenBranch(), indent + 2);
+                    push("ThenBranch", indent + 1);
+                    push(if_node.getCondition(), indent + 2);
+                    break;
+                }
+                case NodeKind::SKIP:
+                    line("SkipNode", indent);
+                    break;
+                case NodeKind::WHILE:
+                {
+                    auto &while_node = static_cast<const WhileNode &>(node);
+                    line("WhileNode", indent);
+                    line("Condition", indent + 1);
+                    push(while_node.getStatement(), indent + 2);
+                    push("Statement", indent + 1);
+                    push(while_node.getCondition(), indent + 2);
+                    break;
+                }
+                case NodeKind::MATH_EXPRESSION:
+                {
+                    auto &math = static_cast<const MathExpressionNode &>(node);
+                    // the single operand form is printed as its operand
+                    if (math.getOpcode() == TokenType::UNKNOWN || !math.getRightExpression())
+                    {
+                        push(math.getLeftExpression(), indent);
+                        break;
+                    }
+                    line("MathExpressionNode", indent);
+                    line("MathOp", indent + 1);
+                    prefix(indent + 2);
+                    m_out << '(' << math.getOperation() << ")\n";
+                    line("LeftSideExpression", indent + 1);
+                    push(math.getRightExpression(), indent + 2);
+                    push("RightSideExpression", indent + 1);
+                    push(math.getLeftExpression(), indent + 2);
+                    break;
+                }
+                case NodeKind::NOT_PREDICATE:
+                    line("NotPredicateNode", indent);
+                    push(static_cast<const NotPredicateNode &>(node).getPredicate(), indent + 1);
+                    break;
+                case NodeKind::BOOLEAN_PREDICATE:
+                {
+                    auto &boolean = static_cast<const BooleanPredicateNode &>(node);
+                    line("BooleanPredicateNode", indent);
+                    line("BooleanOp", indent + 1);
+                    line(boolean.getOperation(), indent + 2);
+                    line("LeftSidePredicate", indent + 1);
+                    push(boolean.getRightPredicate(), indent + 2);
+                    push("RightSidePredicate", indent + 1);
+                    push(boolean.getLeftPredicate(), indent + 2);
+                    break;
+                }
+                case NodeKind::RELATIONAL_PREDICATE:
+                {
+                    auto &relational = static_cast<const RelationalPredicateNode &>(node);
+                    if (relational.getOpcode() == TokenType::UNKNOWN || !relational.getRightExpression())
+                    {
+                        line("Expression", indent);
+                        push(relational.getLeftExpression(), indent + 1);
+                        break;
+                    }
+                    line("RelationalPredicateNode", indent);
+                    line("RelationalOp", indent + 1);
+                    line(relational.getOperation(), indent + 2);
+                    line("LeftSideExpression", indent + 1);
+                    push(relational.getRightExpression(), indent + 2);
+                    push("RightSideExpression", indent + 1);
+                    push(relational.getLeftExpression(), indent + 2);
+                    break;
+                }
+                }
+            }
+
+            std::ostream &m_out;
+            std::string m_bars;
+            std::vector<Item> m_stack;
+        };
+    }
+
+    ASTNode::~ASTNode()
+    {
+        // only the outermost destructor empties the list: the ones that run in here just add
+        // their children to it
+        if (t_destroying)
+            return;
+
+        t_destroying = true;
+        while (!t_pending.empty())
+        {
+            std::unique_ptr<ASTNode> node = std::move(t_pending.back());
+            t_pending.pop_back();
+        }
+        t_destroying = false;
+    }
+
+    void ASTNode::destroyLater(std::unique_ptr<ASTNode> child)
+    {
+        if (child)
+            t_pending.push_back(std::move(child));
+    }
+
+    void ASTNode::printNode(std::ostream &out, int indent) const
+    {
+        TreePrinter(out).print(this, indent);
+    }
+
+    bool isStructurallyEqual(const ASTNode *left, const ASTNode *right)
+    {
+        std::vector<std::pair<const ASTNode *, const ASTNode *>> stack;
+        stack.reserve(64);
+        stack.emplace_back(left, right);
+
+        while (!stack.empty())
+        {
+            auto [l, r] = stack.back();
+            stack.pop_back();
+
+            // the same node (shared subtrees) or both missing
+            if (l == r)
+                continue;
+            // different hashes are a difference somewhere in the subtrees
+            if (l == nullptr || r == nullptr || l->getKind() != r->getKind() || l->getHash() != r->getHash())
+                return false;
+
+            // the payload is compared before going down, children are pushed right to left
+            // so that they are compared left to right
+            switch (l->getKind())
+            {
+            case NodeKind::ROOT:
+            {
+                const auto &left_children = static_cast<const RootNode *>(l)->getChildren();
+                const auto &right_children = static_cast<const RootNode *>(r)->getChildren();
+                if (left_children.size() != right_children.size())
+                    return false;
+                for (std::size_t idx = left_children.size(); idx-- > 0;)
+                    stack.emplace_back(left_children[idx].get(), right_children[idx].get());
+                break;
+            }
+            case NodeKind::NUMBER_LITERAL:
+            {
+                auto left_number = static_cast<const NumberLiteralNode *>(l);
+                auto right_number = static_cast<const NumberLiteralNode *>(r);
+                if (left_number->getValue() != right_number->getValue() || left_number->getDigits() != right_number->getDigits())
+                    return false;
+                break;
+            }
+            case NodeKind::VARIABLE_REF:
+                if (static_cast<const VariableRefNode *>(l)->getName() != static_cast<const VariableRefNode *>(r)->getName())
+                    return false;
+                break;
+            case NodeKind::PREDICATE:
+                if (static_cast<const PredicateNode *>(l)->getConstant() != static_cast<const PredicateNode *>(r)->getConstant())
+                    return false;
+                break;
+            case NodeKind::ASSIGNMENT:
+            {
+                auto left_assignment = static_cast<const AssignmentNode *>(l);
+                auto right_assignment = static_cast<const AssignmentNode *>(r);
+                if (left_assignment->getVariableName() != right_assignment->getVariableName())
+                    return false;
+                stack.emplace_back(left_assignment->getExpression(), right_assignment->getExpression());
+                break;
+            }
+            case NodeKind::IF:
+            {
+                auto left_if = static_cast<const IfNode *>(l);
+                auto right_if = static_cast<const IfNode *>(r);
+                stack.emplace_back(left_if->getElseBranch(), right_if->getElseBranch());
+                stack.emplace_back(left_if->getThenBranch(), right_if->getThenBranch());
+                stack.emplace_back(left_if->getCondition(), right_if->getCondition());
+                break;
+            }
+            case NodeKind::SKIP:
+                break;
+            case NodeKind::WHILE:
+            {
+                auto left_while = static_cast<const WhileNode *>(l);
+                auto right_while = static_cast<const WhileNode *>(r);
+                stack.emplace_back(left_while->getStatement(), right_while->getStatement());
+                stack.emplace_back(left_while->getCondition(), right_while->getCondition());
+                break;
+            }
+            case NodeKind::MATH_EXPRESSION:
+            {
+                auto left_math = static_cast<const MathExpressionNode *>(l);
+                auto right_math = static_cast<const MathExpressionNode *>(r);
+                if (left_math->getOpcode() != right_math->getOpcode())
+                    return false;
+                stack.emplace_back(left_math->getRightExpression(), right_math->getRightExpression());
+                stack.emplace_back(left_math->getLeftExpression(), right_math->getLeftExpression());
+                break;
+            }
+            case NodeKind::NOT_PREDICATE:
+                stack.emplace_back(static_cast<const NotPredicateNode *>(l)->getPredicate(), static_cast<const NotPredicateNode *>(r)->getPredicate());
+                break;
+            case NodeKind::BOOLEAN_PREDICATE:
+            {
+                auto left_boolean = static_cast<const BooleanPredicateNode *>(l);
+                auto right_boolean = static_cast<const BooleanPredicateNode *>(r);
+                if (left_boolean->getOpcode() != right_boolean->getOpcode())
+                    return false;
+                stack.emplace_back(left_boolean->getRightPredicate(), right_boolean->getRightPredicate());
+                stack.emplace_back(left_boolean->getLeftPredicate(), right_boolean->getLeftPredicate());
+                break;
+            }
+            case NodeKind::RELATIONAL_PREDICATE:
+            {
+                auto left_relational = static_cast<const RelationalPredicateNode *>(l);
+                auto right_relational = static_cast<const RelationalPredicateNode *>(r);
+                if (left_relational->getOpcode() != right_relational->getOpcode())
+                    return false;
+                stack.emplace_back(left_relational->getRightExpression(), right_relational->getRightExpression());
+                stack.emplace_back(left_relational->getLeftExpression(), right_relational->getLeftExpression());
+                break;
+            }
+            }
+        }
+
+        return true;
+    }
+
+    TokenType operatorOf(std::string_view spelling)
+    {
+        if (spelling.empty())
+            return TokenType::UNKNOWN;
+
+        std::size_t length = 0;
+        TokenType type = classifyWord(spelling);
+        if (type == TokenType::IDENTIFIER)
+            type = classifySymbol(spelling[0], spelling.size() > 1 ? spelling[1] : '\0', length);
+        else
+            length = spelling.size();
+
+        if (type == TokenType::UNKNOWN || length != spelling.size())
+            throw std::invalid_argument("Unknown operator: " + std::string(spelling));
+        return type;
+    }
+}
@@ -0,0 +1,66 @@
+#include "../include/Arena.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace WhileParser
+{
+    thread_local Arena *Arena::s_active = nullptr;
+
+    Arena::Arena(std::size_t block_size)
+        : m_head(nullptr), m_cursor(0), m_end(0), m_next_block_size(block_size), m_blocks(0), m_reserved(0)
+    {
+    }
+
+    Arena::~Arena()
+    {
+        while (m_head)
+        {
+            Block *next = m_head->next;
+            ::operator delete(m_head);
+            m_head = next;
+        }
+    }
+
+    void *Arena::allocateSlow(std::size_t size, std::size_t alignment)
+    {
+        // blocks grow geometrically, so a big tree needs few of them
+        std::size_t block_size = std::max(m_next_block_size, sizeof(Block) + size + alignment);
+        m_next_block_size = std::min(m_next_block_size * 2, MAX_BLOCK_SIZE);
+
+        auto block = static_cast<Block *>(::operator new(block_size));
+        block->next = m_head;
+        m_head = block;
+        ++m_blocks;
+        m_reserved += block_size;
+
+        m_cursor = reinterpret_cast<std::uintptr_t>(block) + sizeof(Block);
+        m_end = reinterpret_cast<std::uintptr_t>(block) + block_size;
+        return allocate(size, alignment);
+    }
+
+    std::string_view Arena::copy(std::string_view text)
+    {
+        if (text.empty())
+            return {};
+
+        auto data = static_cast<char *>(allocate(text.size(), 1));
+        std::memcpy(data, text.data(), text.size());
+        return std::string_view(data, text.size());
+    }
+
+    void *Arena::allocateNode(std::size_t size)
+    {
+        if (s_active)
+            return s_active->allocate(size, alignof(std::max_align_t));
+        return ::operator new(size);
+    }
+
+    void Arena::deallocateNode(void *node)
+    {
+        // nodes of an arena are released with it
+        if (s_active)
+            return;
+        ::operator delete(node);
+    }
+}
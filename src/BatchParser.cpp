@@ -0,0 +1,177 @@
+#include "../include/BatchParser.hpp"
+#include "../include/Parser.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <numeric>
+#include <stdexcept>
+#include <thread>
+
+namespace WhileParser
+{
+    namespace
+    {
+        // files of a worker: the owner takes them from the front, the thieves from the back
+        class WorkQueue
+        {
+        public:
+            inline void push(std::size_t job)
+            {
+                m_jobs.push_back(job);
+            }
+
+            bool take(std::size_t &job)
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                if (m_jobs.empty())
+                    return false;
+                job = m_jobs.front();
+                m_jobs.pop_front();
+                return true;
+            }
+
+            bool steal(std::size_t &job)
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                if (m_jobs.empty())
+                    return false;
+                job = m_jobs.back();
+                m_jobs.pop_back();
+                return true;
+            }
+
+        private:
+            std::mutex m_mutex;
+            std::deque<std::size_t> m_jobs;
+        };
+
+        std::size_t fileSize(const std::string &path)
+        {
+            std::error_code error;
+            auto size = std::filesystem::file_size(path, error);
+            return error ? 0 : static_cast<std::size_t>(size);
+        }
+    }
+
+    BatchParser::BatchParser(unsigned threads)
+        : m_threads(threads != 0 ? threads : std::max(1u, std::thread::hardware_concurrency())), m_cache(nullptr),
+          m_parsers(ParseMode::EXPLICIT_STACK)
+    {
+    }
+
+    std::vector<FileResult> BatchParser::parseFiles(const std::vector<std::string> &paths)
+    {
+        std::vector<FileResult> results(paths.size());
+        std::size_t workers = std::min<std::size_t>(m_threads, std::max<std::size_t>(paths.size(), 1));
+
+        // the biggest files are dealt first, so every queue starts with its biggest one
+        std::vector<std::size_t> sizes(paths.size());
+        std::vector<std::size_t> order(paths.size());
+        for (std::size_t idx = 0; idx < paths.size(); ++idx)
+            sizes[idx] = fileSize(paths[idx]);
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [&sizes](std::size_t left, std::size_t right)
+                         { return sizes[left] > sizes[right]; });
+
+        std::vector<WorkQueue> queues(workers);
+        for (std::size_t idx = 0; idx < order.size(); ++idx)
+            queues[idx % workers].push(order[idx]);
+
+        // no file is added after the start, so a worker that finds every queue empty is done
+        auto work = [this, &paths, &results, &queues, workers](std::size_t self)
+        {
+            std::size_t job = 0;
+            auto parser = m_parsers.acquire();
+            while (true)
+            {
+                bool found = queues[self].take(job);
+                for (std::size_t other = 1; !found && other < workers; ++other)
+                    found = queues[(self + other) % workers].steal(job);
+                if (!found)
+                    return;
+
+                results[job] = parseFile(paths[job], *parser);
+            }
+        };
+
+        std::vector<std::thread> threads;
+        for (std::size_t idx = 1; idx < workers; ++idx)
+            threads.emplace_back(work, idx);
+        work(0);
+        for (auto &thread : threads)
+            thread.join();
+
+        return results;
+    }
+
+    FileResult BatchParser::parseFile(const std::string &path, Parser &parser) const
+    {
+        FileResult result{path, false, 0, {}, false, fileSize(path), 0.0};
+        auto start = std::chrono::steady_clock::now();
+
+        try
+        {
+            auto source = ParseCache::openSource(path);
+            std::string key = m_cache ? ParseCache::keyOf(source->text()) : std::string();
+
+            // only the files without errors are stored, so a hit is a file that passes
+            if (m_cache && m_cache->find(key))
+            {
+                result.ok = true;
+                result.cached = true;
+            }
+            else
+            {
+                // a file of the batch must not overflow the stack of its worker, whatever its nesting:
+                // the parsers of the pool use the explicit stack
+                parser.reset(source);
+                ParseResult parsed = parser.parseWithDiagnostics();
+                result.ok = parsed.ok();
+                result.errors = parsed.diagnostics.size();
+                if (!parsed.ok())
+                    result.message = parsed.diagnostics.front().message + " (offset " + std::to_string(parsed.diagnostics.front().offset) + ")";
+                else if (m_cache)
+                    m_cache->store(key, FlatAST::fromTree(*parsed.root));
+            }
+        }
+        catch (const std::exception &exception)
+        {
+            // e.g. a file that can't be opened, or without the .wh extension
+            result.message = exception.what();
+        }
+
+        result.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        return result;
+    }
+
+    std::vector<std::string> BatchParser::collectFiles(const std::string &path)
+    {
+        namespace fs = std::filesystem;
+
+        std::vector<std::string> files;
+        if (fs::is_directory(path))
+        {
+            for (const auto &entry : fs::recursive_directory_iterator(path))
+                if (entry.is_regular_file() && entry.path().extension() == ".wh")
+                    files.push_back(entry.path().string());
+            std::sort(files.begin(), files.end());
+            return files;
+        }
+
+        if (fs::path(path).extension() == ".wh")
+            return {path};
+
+        std::ifstream list(path);
+        if (!list)
+            throw std::runtime_error("Impossible to open the file list " + path);
+        for (std::string line; std::getline(list, line);)
+            if (!line.empty())
+                files.push_back(line);
+        return files;
+    }
+}
@@ -0,0 +1,158 @@
+#include "../include/DfaLexer.hpp"
+#include "../include/Keywords.hpp"
+
+namespace WhileParser
+{
+    namespace
+    {
+        constexpr std::array<std::uint8_t, 256> makeCharacterClasses()
+        {
+            std::array<std::uint8_t, 256> classes{};
+            for (int c = 'a'; c <= 'z'; ++c)
+                classes[c] = DfaLexer::CLASS_LETTER;
+            for (int c = 'A'; c <= 'Z'; ++c)
+                classes[c] = DfaLexer::CLASS_LETTER;
+            for (int c = '0'; c <= '9'; ++c)
+                classes[c] = DfaLexer::CLASS_DIGIT;
+            classes['_'] = DfaLexer::CLASS_UNDERSCORE;
+            classes[' '] = DfaLexer::CLASS_SPACE;
+            classes['\n'] = DfaLexer::CLASS_NEWLINE;
+            classes[':'] = DfaLexer::CLASS_COMPOUND_PREFIX;
+            classes['<'] = DfaLexer::CLASS_COMPOUND_PREFIX;
+            classes['>'] = DfaLexer::CLASS_COMPOUND_PREFIX;
+            classes['='] = DfaLexer::CLASS_EQUALS;
+            for (char c : {';', '+', '-', '*', '/', '(', ')'})
+                classes[static_cast<unsigned char>(c)] = DfaLexer::CLASS_SYMBOL;
+            return classes;
+        }
+
+        // Skipped whitespaces and newlines loop on the start state, so they are consumed
+        // by the same loop that recognizes the following token.
+        constexpr DfaLexer::TransitionTable makeTransitions(bool skip_whitespaces, bool skip_eol)
+        {
+            DfaLexer::TransitionTable table{};
+            for (auto &row : table)
+                for (auto &next : row)
+                    next = DfaLexer::STATE_DEAD;
+
+            auto &start = table[DfaLexer::STATE_START];
+            start[DfaLexer::CLASS_OTHER] = DfaLexer::STATE_OTHER;
+            start[DfaLexer::CLASS_LETTER] = DfaLexer::STATE_IDENTIFIER;
+            start[DfaLexer::CLASS_UNDERSCORE] = DfaLexer::STATE_IDENTIFIER;
+            start[DfaLexer::CLASS_DIGIT] = DfaLexer::STATE_NUMBER;
+            start[DfaLexer::CLASS_SPACE] = skip_whitespaces ? DfaLexer::STATE_START : DfaLexer::STATE_SPACE;
+            start[DfaLexer::CLASS_NEWLINE] = skip_eol ? DfaLexer::STATE_START : DfaLexer::STATE_NEWLINE;
+            start[DfaLexer::CLASS_COMPOUND_PREFIX] = DfaLexer::STATE_COMPOUND_PREFIX;
+            start[DfaLexer::CLASS_EQUALS] = DfaLexer::STATE_SYMBOL;
+            start[DfaLexer::CLASS_SYMBOL] = DfaLexer::STATE_SYMBOL;
+
+            auto &identifier = table[DfaLexer::STATE_IDENTIFIER];
+            identifier[DfaLexer::CLASS_LETTER] = DfaLexer::STATE_IDENTIFIER;
+            identifier[DfaLexer::CLASS_UNDERSCORE] = DfaLexer::STATE_IDENTIFIER;
+            identifier[DfaLexer::CLASS_DIGIT] = DfaLexer::STATE_IDENTIFIER;
+
+            // a letter right after a number is glued to it in an UNKNOWN token
+            auto &number = table[DfaLexer::STATE_NUMBER];
+            number[DfaLexer::CLASS_DIGIT] = DfaLexer::STATE_NUMBER;
+            number[DfaLexer::CLASS_LETTER] = DfaLexer::STATE_NUMBER_LETTER;
+
+            // :=, <=, >=
+            table[DfaLexer::STATE_COMPOUND_PREFIX][DfaLexer::CLASS_EQUALS] = DfaLexer::STATE_SYMBOL;
+
+            return table;
+        }
+
+        constexpr std::array<std::uint8_t, 256> CHARACTER_CLASSES = makeCharacterClasses();
+
+        // indexed by [skip_whitespaces][skip_eol]
+        constexpr DfaLexer::TransitionTable TRANSITIONS[2][2] = {
+            {makeTransitions(false, false), makeTransitions(false, true)},
+            {makeTransitions(true, false), makeTransitions(true, true)}};
+    }
+
+    DfaLexer::DfaLexer(std::shared_ptr<const SourceBuffer> source, bool skip_whitespaces, bool skip_eol)
+        : m_source(std::move(source)), m_transitions(&TRANSITIONS[skip_whitespaces][skip_eol]),
+          m_cursor(m_source->begin()), m_end(m_source->end()), m_eof(false)
+    {
+    }
+
+    Token DfaLexer::nextToken()
+    {
+        const TransitionTable &transitions = *m_transitions;
+        const char *start = m_cursor;
+        State state = STATE_START;
+
+        while (m_cursor != m_end)
+        {
+            State next = transitions[state][CHARACTER_CLASSES[static_cast<unsigned char>(*m_cursor)]];
+            if (next == STATE_DEAD)
+                break;
+
+            ++m_cursor;
+            // skipped trivia, the token starts after it
+            if (next == STATE_START)
+                start = m_cursor;
+            state = next;
+        }
+
+        if (state == STATE_START)
+        {
+            m_eof = true;
+            return {TokenType::END_OF_FILE, "EOF", m_source->size()};
+        }
+
+        return accept(state, start);
+    }
+
+    Token DfaLexer::accept(State state, const char *start)
+    {
+        std::string_view lexeme(start, m_cursor - start);
+        std::size_t offset = static_cast<std::size_t>(start - m_source->begin());
+
+        switch (state)
+        {
+        case STATE_IDENTIFIER:
+        {
+            TokenType keyword = classifyWord(lexeme);
+            if (keyword != TokenType::IDENTIFIER)
+                return {keyword, tokenSpelling(keyword), offset};
+            return {TokenType::IDENTIFIER, lexeme, offset};
+        }
+        case STATE_NUMBER:
+            return {TokenType::NUMBER, lexeme, offset, parseNumber(lexeme.data(), lexeme.data() + lexeme.size())};
+        case STATE_COMPOUND_PREFIX:
+        case STATE_SYMBOL:
+        {
+            std::size_t length;
+            TokenType type = classifySymbol(lexeme[0], lexeme.size() > 1 ? lexeme[1] : '\0', length);
+            if (type == TokenType::UNKNOWN)
+                return {TokenType::UNKNOWN, lexeme, offset};
+            return {type, tokenSpelling(type), offset};
+        }
+        case STATE_SPACE:
+            return {TokenType::WHITESPACE, tokenSpelling(TokenType::WHITESPACE), offset};
+        case STATE_NEWLINE:
+            return {TokenType::END_OF_LINE, tokenSpelling(TokenType::END_OF_LINE), offset};
+        default:
+            // STATE_NUMBER_LETTER and STATE_OTHER
+            return {TokenType::UNKNOWN, lexeme, offset};
+        }
+    }
+
+    TokenStream DfaLexer::tokenizeAll()
+    {
+        TokenStream tokens(m_source);
+        tokens.reserve(static_cast<std::size_t>(m_end - m_cursor) / 4 + 1);
+
+        while (true)
+        {
+            Token token = nextToken();
+            if (token.getType() == TokenType::END_OF_FILE)
+            {
+                tokens.push(TokenType::END_OF_FILE, token.getOffset(), 0);
+                return tokens;
+            }
+            tokens.push(token.getType(), token.getOffset(), static_cast<std::uint32_t>(token.getValue().size()));
+        }
+    }
+}
@@ -0,0 +1,638 @@
+#include "../include/FlatAST.hpp"
+#include "../include/Keywords.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace WhileParser
+{
+    namespace
+    {
+        // layout of a file: the header, then the sections in the order of the fields that count them
+        struct FileHeader
+        {
+            char magic[8];
+            std::uint32_t version;
+            std::uint32_t byte_order; // BYTE_ORDER_MARK as the writer stored it
+            std::uint32_t nodes;
+            std::uint32_t texts;
+            std::uint32_t pool;
+            std::uint32_t reserved;
+        };
+
+        constexpr char MAGIC[8] = {'W', 'H', 'I', 'L', 'E', 'A', 'S', 'T'};
+        constexpr std::uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+        // byte offsets of the sections, each aligned for its type
+        struct FileLayout
+        {
+            std::size_t nodes;
+            std::size_t offsets;
+            std::size_t numbers;
+            std::size_t pool;
+            std::size_t end;
+        };
+
+        FileLayout layoutOf(std::size_t nodes, std::size_t texts, std::size_t pool)
+        {
+            FileLayout layout;
+            layout.nodes = sizeof(FileHeader);
+            layout.offsets = layout.nodes + nodes * sizeof(FlatAST::Node);
+            layout.numbers = (layout.offsets + (texts + 1) * sizeof(std::uint32_t) + 7) & ~std::size_t(7);
+            layout.pool = layout.numbers + texts * sizeof(std::uint64_t);
+            layout.end = layout.pool + pool;
+            return layout;
+        }
+
+        std::uint64_t numberValue(std::string_view text)
+        {
+            std::uint64_t value = 0;
+            auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+            if (text.empty() || error != std::errc() || end != text.data() + text.size())
+                return FlatAST::NO_NUMBER;
+            return value;
+        }
+
+        enum class Category
+        {
+            EXPRESSION,
+            PREDICATE,
+            STATEMENT,
+            ROOT
+        };
+
+        Category categoryOf(NodeKind kind)
+        {
+            switch (kind)
+            {
+            case NodeKind::NUMBER_LITERAL:
+            case NodeKind::VARIABLE_REF:
+            case NodeKind::MATH_EXPRESSION:
+                return Category::EXPRESSION;
+            case NodeKind::PREDICATE:
+            case NodeKind::NOT_PREDICATE:
+            case NodeKind::BOOLEAN_PREDICATE:
+            case NodeKind::RELATIONAL_PREDICATE:
+                return Category::PREDICATE;
+            case NodeKind::ROOT:
+                return Category::ROOT;
+            default:
+                return Category::STATEMENT;
+            }
+        }
+
+        // operators a node of the kind can carry, UNKNOWN being the single operand forms
+        bool isOperatorOf(NodeKind kind, TokenType op)
+        {
+            switch (kind)
+            {
+            case NodeKind::MATH_EXPRESSION:
+                return op == TokenType::UNKNOWN || op == TokenType::PLUS || op == TokenType::MINUS ||
+                       op == TokenType::WILDCARD || op == TokenType::SLASH;
+            case NodeKind::BOOLEAN_PREDICATE:
+                return op == TokenType::AND || op == TokenType::OR;
+            case NodeKind::RELATIONAL_PREDICATE:
+                return op == TokenType::UNKNOWN || op == TokenType::EQ || op == TokenType::LT ||
+                       op == TokenType::LTE || op == TokenType::GT || op == TokenType::GTE;
+            case NodeKind::PREDICATE:
+                return op == TokenType::TRUE || op == TokenType::FALSE;
+            default:
+                return op == TokenType::UNKNOWN;
+            }
+        }
+
+        // a loaded file has valid indices, but its nodes could still break the grammar
+        void checkChildren(const FlatAST &flat, FlatAST::NodeIndex idx)
+        {
+            Category expected[3];
+            std::size_t count = 0;
+            bool single = flat.getOperator(idx) == TokenType::UNKNOWN;
+
+            switch (flat.getKind(idx))
+            {
+            case NodeKind::ROOT:
+            {
+                flat.forEachChild(idx, [&flat](FlatAST::NodeIndex child)
+                                  {
+                                      if (categoryOf(flat.getKind(child)) != Category::STATEMENT)
+                                          throw std::invalid_argument("The flat AST has a root child that is not a statement"); });
+                return;
+            }
+            case NodeKind::ASSIGNMENT:
+                expected[count++] = Category::EXPRESSION;
+                break;
+            case NodeKind::IF:
+                expected[count++] = Category::PREDICATE;
+                expected[count++] = Category::STATEMENT;
+                expected[count++] = Category::STATEMENT;
+                break;
+            case NodeKind::WHILE:
+                expected[count++] = Category::PREDICATE;
+                expected[count++] = Category::STATEMENT;
+                break;
+            case NodeKind::MATH_EXPRESSION:
+            case NodeKind::RELATIONAL_PREDICATE:
+                expected[count++] = Category::EXPRESSION;
+                if (!single)
+                    expected[count++] = Category::EXPRESSION;
+                break;
+            case NodeKind::NOT_PREDICATE:
+                expected[count++] = Category::PREDICATE;
+                break;
+            case NodeKind::BOOLEAN_PREDICATE:
+                expected[count++] = Category::PREDICATE;
+                expected[count++] = Category::PREDICATE;
+                break;
+            default:
+                break;
+            }
+
+            std::size_t found = 0;
+            flat.forEachChild(idx, [&](FlatAST::NodeIndex child)
+                              {
+                                  if (found >= count || categoryOf(flat.getKind(child)) != expected[found])
+                                      throw std::invalid_argument("The flat AST has a node with unexpected children");
+                                  ++found; });
+            if (found != count)
+                throw std::invalid_argument("The flat AST has a node with missing children");
+        }
+
+        class Builder
+        {
+        public:
+            Builder(std::vector<FlatAST::Node> &nodes, std::vector<char> &pool, std::vector<std::uint32_t> &offsets,
+                    std::vector<std::uint64_t> &numbers)
+                : m_nodes(nodes), m_pool(pool), m_offsets(offsets), m_numbers(numbers)
+            {
+                m_offsets.push_back(0);
+            }
+
+            void build(const RootNode &root)
+            {
+                // a node is pushed twice: to be emitted, and then to close its subtree
+                struct Entry
+                {
+                    const ASTNode *node;
+                    FlatAST::NodeIndex index;
+                };
+                std::vector<Entry> stack{{&root, FlatAST::NO_NODE}};
+                std::vector<const ASTNode *> children;
+
+                while (!stack.empty())
+                {
+                    Entry entry = stack.back();
+                    stack.pop_back();
+
+                    if (entry.index != FlatAST::NO_NODE)
+                    {
+                        m_nodes[entry.index].end = static_cast<FlatAST::NodeIndex>(m_nodes.size());
+                        continue;
+                    }
+
+                    auto index = static_cast<FlatAST::NodeIndex>(m_nodes.size());
+                    children.clear();
+                    m_nodes.push_back(emit(*entry.node, children));
+                    stack.push_back({entry.node, index});
+
+                    // the kind of a node tells how many children it has, a hole can't be written
+                    for (auto child = children.rbegin(); child != children.rend(); ++child)
+                    {
+                        if (!*child)
+                            throw std::invalid_argument("The tree has a node with missing children");
+                        stack.push_back({*child, FlatAST::NO_NODE});
+                    }
+                }
+            }
+
+        private:
+            FlatAST::Node emit(const ASTNode &node, std::vector<const ASTNode *> &children)
+            {
+                FlatAST::Node flat{node.getKind(), TokenType::UNKNOWN, 0, FlatAST::NO_TEXT};
+
+                switch (flat.kind)
+                {
+                case NodeKind::ROOT:
+                    for (const auto &child : static_cast<const RootNode &>(node).getChildren())
+                        children.push_back(child.get());
+                    break;
+                case NodeKind::NUMBER_LITERAL:
+                    flat.text = internNumber(static_cast<const NumberLiteralNode &>(node));
+                    break;
+                case NodeKind::VARIABLE_REF:
+                    flat.text = intern(static_cast<const VariableRefNode &>(node).getName());
+                    break;
+                case NodeKind::PREDICATE:
+                    flat.op = static_cast<const PredicateNode &>(node).getConstant();
+                    break;
+                case NodeKind::ASSIGNMENT:
+                {
+                    auto &assignment = static_cast<const AssignmentNode &>(node);
+                    flat.text = intern(assignment.getVariableName());
+                    children.push_back(assignment.getExpression());
+                    break;
+                }
+                case NodeKind::IF:
+                {
+                    auto &if_node = static_cast<const IfNode &>(node);
+                    children.push_back(if_node.getCondition());
+                    children.push_back(if_node.getThenBranch());
+                    children.push_back(if_node.getElseBranch());
+                    break;
+                }
+                case NodeKind::SKIP:
+                    break;
+                case NodeKind::WHILE:
+                {
+                    auto &while_node = static_cast<const WhileNode &>(node);
+                    children.push_back(while_node.getCondition());
+                    children.push_back(while_node.getStatement());
+                    break;
+                }
+                case NodeKind::MATH_EXPRESSION:
+                {
+                    auto &math = static_cast<const MathExpressionNode &>(node);
+                    flat.op = math.getOpcode();
+                    children.push_back(math.getLeftExpression());
+                    children.push_back(math.getRightExpression());
+                    break;
+                }
+                case NodeKind::NOT_PREDICATE:
+                    children.push_back(static_cast<const NotPredicateNode &>(node).getPredicate());
+                    break;
+                case NodeKind::BOOLEAN_PREDICATE:
+                {
+                    auto &boolean = static_cast<const BooleanPredicateNode &>(node);
+                    flat.op = boolean.getOpcode();
+                    children.push_back(boolean.getLeftPredicate());
+                    children.push_back(boolean.getRightPredicate());
+                    break;
+                }
+                case NodeKind::RELATIONAL_PREDICATE:
+                {
+                    auto &relational = static_cast<const RelationalPredicateNode &>(node);
+                    flat.op = relational.getOpcode();
+                    children.push_back(relational.getLeftExpression());
+                    children.push_back(relational.getRightExpression());
+                    break;
+                }
+                }
+
+                // the single operand forms have no right side
+                if ((flat.kind == NodeKind::MATH_EXPRESSION || flat.kind == NodeKind::RELATIONAL_PREDICATE) &&
+                    flat.op == TokenType::UNKNOWN)
+                    children.pop_back();
+
+                return flat;
+            }
+
+            std::uint32_t intern(std::string_view text)
+            {
+                auto found = m_interned.find(text);
+                if (found != m_interned.end())
+                    return found->second;
+
+                auto id = add(text, numberValue(text));
+                m_interned.emplace(text, id);
+                return id;
+            }
+
+            // the value is already known, only the digits of a number that overflows are converted
+            std::uint32_t internNumber(const NumberLiteralNode &number)
+            {
+                if (number.isOverflow())
+                    return intern(number.getDigits());
+
+                auto found = m_interned_numbers.find(number.getValue());
+                if (found != m_interned_numbers.end())
+                    return found->second;
+
+                auto id = add(number.toString(), static_cast<std::uint64_t>(number.getValue()));
+                m_interned_numbers.emplace(number.getValue(), id);
+                return id;
+            }
+
+            std::uint32_t add(std::string_view text, std::uint64_t number)
+            {
+                auto id = static_cast<std::uint32_t>(m_offsets.size() - 1);
+                m_pool.insert(m_pool.end(), text.begin(), text.end());
+                m_offsets.push_back(static_cast<std::uint32_t>(m_pool.size()));
+                m_numbers.push_back(number);
+                return id;
+            }
+
+            std::vector<FlatAST::Node> &m_nodes;
+            std::vector<char> &m_pool;
+            std::vector<std::uint32_t> &m_offsets;
+            std::vector<std::uint64_t> &m_numbers;
+            // the keys view the texts of the tree, that outlives the builder
+            std::unordered_map<std::string_view, std::uint32_t> m_interned;
+            std::unordered_map<std::int64_t, std::uint32_t> m_interned_numbers;
+        };
+
+        template <typename T>
+        std::unique_ptr<T> pop(std::vector<std::unique_ptr<ASTNode>> &stack)
+        {
+            std::unique_ptr<T> node(static_cast<T *>(stack.back().release()));
+            stack.pop_back();
+            return node;
+        }
+    }
+
+    FlatAST FlatAST::fromTree(const RootNode &root)
+    {
+        FlatAST flat;
+        Builder(flat.m_nodes, flat.m_pool, flat.m_text_offsets, flat.m_numbers).build(root);
+        flat.m_nodes.shrink_to_fit();
+        flat.bindArrays();
+        return flat;
+    }
+
+    FlatAST::FlatAST(const FlatAST &other)
+        : m_nodes(other.m_nodes), m_pool(other.m_pool), m_text_offsets(other.m_text_offsets), m_numbers(other.m_numbers),
+          m_file(other.m_file), m_node_data(other.m_node_data), m_node_count(other.m_node_count), m_pool_data(other.m_pool_data),
+          m_offset_data(other.m_offset_data), m_text_count(other.m_text_count), m_number_data(other.m_number_data)
+    {
+        // a copy of a mapped FlatAST shares the mapping, the others get their own arrays
+        if (!m_file)
+            bindArrays();
+    }
+
+    FlatAST &FlatAST::operator=(const FlatAST &other)
+    {
+        if (this != &other)
+            *this = FlatAST(other);
+        return *this;
+    }
+
+    void FlatAST::bindArrays()
+    {
+        m_node_data = m_nodes.data();
+        m_node_count = m_nodes.size();
+        m_pool_data = m_pool.data();
+        m_offset_data = m_text_offsets.data();
+        m_text_count = m_text_offsets.empty() ? 0 : m_text_offsets.size() - 1;
+        m_number_data = m_numbers.data();
+    }
+
+    void FlatAST::save(const std::string &filename) const
+    {
+        std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+        if (!out)
+            throw std::runtime_error("Impossible to open the file " + filename);
+
+        std::size_t pool = m_text_count == 0 ? 0 : m_offset_data[m_text_count];
+        FileHeader header{};
+        std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+        header.version = FORMAT_VERSION;
+        header.byte_order = BYTE_ORDER_MARK;
+        header.nodes = static_cast<std::uint32_t>(m_node_count);
+        header.texts = static_cast<std::uint32_t>(m_text_count);
+        header.pool = static_cast<std::uint32_t>(pool);
+        out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+        // the padding of the nodes is written as zeros, so the same tree always gives the same file
+        std::vector<Node> chunk;
+        for (std::size_t first = 0; first < m_node_count; first += 4096)
+        {
+            std::size_t count = std::min<std::size_t>(4096, m_node_count - first);
+            chunk.resize(count);
+            std::memset(static_cast<void *>(chunk.data()), 0, count * sizeof(Node));
+            for (std::size_t idx = 0; idx < count; ++idx)
+            {
+                chunk[idx].kind = m_node_data[first + idx].kind;
+                chunk[idx].op = m_node_data[first + idx].op;
+                chunk[idx].end = m_node_data[first + idx].end;
+                chunk[idx].text = m_node_data[first + idx].text;
+            }
+            out.write(reinterpret_cast<const char *>(chunk.data()), static_cast<std::streamsize>(count * sizeof(Node)));
+        }
+
+        FileLayout layout = layoutOf(m_node_count, m_text_count, pool);
+        const std::uint32_t empty_offsets[1] = {0};
+        const std::uint32_t *offsets = m_text_count == 0 ? empty_offsets : m_offset_data;
+        out.write(reinterpret_cast<const char *>(offsets), static_cast<std::streamsize>((m_text_count + 1) * sizeof(std::uint32_t)));
+        const char padding[8] = {};
+        out.write(padding, static_cast<std::streamsize>(layout.numbers - layout.offsets - (m_text_count + 1) * sizeof(std::uint32_t)));
+        out.write(reinterpret_cast<const char *>(m_number_data), static_cast<std::streamsize>(m_text_count * sizeof(std::uint64_t)));
+        out.write(m_pool_data, static_cast<std::streamsize>(pool));
+
+        if (!out.flush())
+            throw std::runtime_error("Impossible to write the file " + filename);
+    }
+
+    FlatAST FlatAST::load(const std::string &filename)
+    {
+        FlatAST flat;
+        flat.m_file = SourceBuffer::map(filename);
+        const char *data = flat.m_file->begin();
+        std::size_t size = flat.m_file->size();
+
+        FileHeader header;
+        if (size < sizeof(header))
+            throw std::invalid_argument("Not a flat AST file: " + filename);
+        std::memcpy(&header, data, sizeof(header));
+        if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0)
+            throw std::invalid_argument("Not a flat AST file: " + filename);
+        if (header.byte_order != BYTE_ORDER_MARK)
+            throw std::invalid_argument("The flat AST file was written with another byte order: " + filename);
+        if (header.version != FORMAT_VERSION)
+            throw std::invalid_argument("Unsupported flat AST version " + std::to_string(header.version) + ": " + filename);
+
+        FileLayout layout = layoutOf(header.nodes, header.texts, header.pool);
+        if (layout.end != size)
+            throw std::invalid_argument("The flat AST file is truncated: " + filename);
+
+        // the mapping is page aligned and so are the sections for their types
+        flat.m_node_data = reinterpret_cast<const Node *>(data + layout.nodes);
+        flat.m_node_count = header.nodes;
+        flat.m_offset_data = reinterpret_cast<const std::uint32_t *>(data + layout.offsets);
+        flat.m_text_count = header.texts;
+        flat.m_number_data = reinterpret_cast<const std::uint64_t *>(data + layout.numbers);
+        flat.m_pool_data = data + layout.pool;
+
+        // every index must stay in the file: texts in the pool, subtrees inside their parents
+        if (flat.m_offset_data[0] != 0 || flat.m_offset_data[header.texts] != header.pool)
+            throw std::invalid_argument("The flat AST file has invalid text offsets: " + filename);
+        for (std::size_t idx = 0; idx < header.texts; ++idx)
+            if (flat.m_offset_data[idx] > flat.m_offset_data[idx + 1])
+                throw std::invalid_argument("The flat AST file has invalid text offsets: " + filename);
+
+        std::vector<NodeIndex> open;
+        for (std::size_t idx = 0; idx < header.nodes; ++idx)
+        {
+            const Node &node = flat.m_node_data[idx];
+            while (!open.empty() && open.back() <= idx)
+                open.pop_back();
+
+            if (node.kind > NodeKind::RELATIONAL_PREDICATE || !isOperatorOf(node.kind, node.op) ||
+                (node.text != NO_TEXT && node.text >= header.texts) || node.end <= idx || node.end > header.nodes ||
+                (!open.empty() && node.end > open.back()))
+                throw std::invalid_argument("The flat AST file has an invalid node at " + std::to_string(idx) + ": " + filename);
+            open.push_back(node.end);
+        }
+
+        return flat;
+    }
+
+    std::unique_ptr<RootNode> FlatAST::toTree() const
+    {
+        if (m_node_count == 0 || m_node_data[0].kind != NodeKind::ROOT)
+            throw std::invalid_argument("The flat AST has no root");
+        checkChildren(*this, 0);
+
+        // the identifiers are interned in pre-order, that is in the order a parse finds them,
+        // so the slots are the ones of the tree that was flattened
+        auto symbols = std::make_shared<SymbolTable>();
+        for (std::size_t idx = 1; idx < m_node_count; ++idx)
+            if (m_node_data[idx].kind == NodeKind::VARIABLE_REF || m_node_data[idx].kind == NodeKind::ASSIGNMENT)
+                symbols->intern(getText(static_cast<NodeIndex>(idx)));
+
+        // in reverse pre-order the children of a node are already built,
+        // and they are on top of the stack with the first one last pushed
+        std::vector<std::unique_ptr<ASTNode>> stack;
+        for (std::size_t idx = m_node_count; idx-- > 1;)
+        {
+            const Node &node = m_node_data[idx];
+            auto index = static_cast<NodeIndex>(idx);
+            checkChildren(*this, index);
+
+            switch (node.kind)
+            {
+            case NodeKind::NUMBER_LITERAL:
+            {
+                // a value beyond int64 (or no value at all) is a number that overflows
+                std::uint64_t value = getNumber(index);
+                if (value <= static_cast<std::uint64_t>(std::numeric_limits<std::int64_t>::max()))
+                    stack.push_back(std::make_unique<NumberLiteralNode>(static_cast<std::int64_t>(value)));
+                else
+                    stack.push_back(std::make_unique<NumberLiteralNode>(NUMBER_OVERFLOW, getText(index)));
+                break;
+            }
+            case NodeKind::VARIABLE_REF:
+            {
+                std::uint32_t slot = symbols->find(getText(index));
+                stack.push_back(std::make_unique<VariableRefNode>(slot, symbols->getName(slot)));
+                break;
+            }
+            case NodeKind::PREDICATE:
+                stack.push_back(std::make_unique<PredicateNode>(node.op));
+                break;
+            case NodeKind::ASSIGNMENT:
+            {
+                auto expression = pop<ExpressionNode>(stack);
+                std::uint32_t slot = symbols->find(getText(index));
+                stack.push_back(std::make_unique<AssignmentNode>(slot, symbols->getName(slot), std::move(expression)));
+                break;
+            }
+            case NodeKind::IF:
+            {
+                auto condition = pop<PredicateNode>(stack);
+                auto then_branch = pop<StatementNode>(stack);
+                auto else_branch = pop<StatementNode>(stack);
+                stack.push_back(std::make_unique<IfNode>(std::move(condition), std::move(then_branch), std::move(else_branch)));
+                break;
+            }
+            case NodeKind::SKIP:
+                stack.push_back(std::make_unique<SkipNode>());
+                break;
+            case NodeKind::WHILE:
+            {
+                auto condition = pop<PredicateNode>(stack);
+                auto statement = pop<StatementNode>(stack);
+                stack.push_back(std::make_unique<WhileNode>(std::move(condition), std::move(statement)));
+                break;
+            }
+            case NodeKind::MATH_EXPRESSION:
+            {
+                auto left = pop<ExpressionNode>(stack);
+                if (node.op == TokenType::UNKNOWN)
+                {
+                    stack.push_back(std::make_unique<MathExpressionNode>(std::move(left)));
+                    break;
+                }
+                auto right = pop<ExpressionNode>(stack);
+                stack.push_back(std::make_unique<MathExpressionNode>(node.op, std::move(left), std::move(right)));
+                break;
+            }
+            case NodeKind::NOT_PREDICATE:
+            {
+                auto predicate = pop<PredicateNode>(stack);
+                stack.push_back(std::make_unique<NotPredicateNode>(std::move(predicate)));
+                break;
+            }
+            case NodeKind::BOOLEAN_PREDICATE:
+            {
+                auto left = pop<PredicateNode>(stack);
+                auto right = pop<PredicateNode>(stack);
+                stack.push_back(std::make_unique<BooleanPredicateNode>(node.op, std::move(left), std::move(right)));
+                break;
+            }
+            case NodeKind::RELATIONAL_PREDICATE:
+            {
+                auto left = pop<ExpressionNode>(stack);
+                if (node.op == TokenType::UNKNOWN)
+                {
+                    stack.push_back(std::make_unique<RelationalPredicateNode>(std::move(left)));
+                    break;
+                }
+                auto right = pop<ExpressionNode>(stack);
+                stack.push_back(std::make_unique<RelationalPredicateNode>(node.op, std::move(left), std::move(right)));
+                break;
+            }
+            case NodeKind::ROOT:
+                throw std::invalid_argument("The flat AST has a nested root");
+            }
+        }
+
+        auto root = std::make_unique<RootNode>();
+        root->setSymbols(std::move(symbols));
+        while (!stack.empty())
+            root->addNode(pop<ASTNode>(stack));
+        return root;
+    }
+
+    std::size_t FlatAST::childCount(NodeIndex idx) const
+    {
+        std::size_t count = 0;
+        forEachChild(idx, [&count](NodeIndex)
+                     { ++count; });
+        return count;
+    }
+
+    FlatAST::NodeIndex FlatAST::getChild(NodeIndex idx, std::size_t n) const
+    {
+        NodeIndex child = firstChild(idx);
+        while (n-- > 0 && child != NO_NODE)
+            child = nextSibling(idx, child);
+        return child;
+    }
+
+    std::size_t FlatAST::memoryUsage() const
+    {
+        if (m_file)
+            return m_file->size();
+        return m_nodes.capacity() * sizeof(Node) + m_pool.capacity() + m_text_offsets.capacity() * sizeof(std::uint32_t) +
+               m_numbers.capacity() * sizeof(std::uint64_t);
+    }
+
+    bool FlatAST::isEqual(const FlatAST &other) const
+    {
+        if (m_node_count != other.m_node_count)
+            return false;
+
+        for (std::size_t idx = 0; idx < m_node_count; ++idx)
+        {
+            const Node &left = m_node_data[idx];
+            const Node &right = other.m_node_data[idx];
+            if (left.kind != right.kind || left.op != right.op || left.end != right.end)
+                return false;
+            if (getText(static_cast<NodeIndex>(idx)) != other.getText(static_cast<NodeIndex>(idx)))
+                return false;
+        }
+        return true;
+    }
+}
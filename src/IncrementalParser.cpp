@@ -0,0 +1,284 @@
+#include "../include/IncrementalParser.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+
+namespace WhileParser
+{
+    namespace
+    {
+        // replaces the items [first, last) of the vector with the new ones, moving the ones after only if their number changes
+        template <typename Vector, typename Items>
+        void splice(Vector &vector, std::size_t first, std::size_t last, Items &items)
+        {
+            std::size_t common = std::min(last - first, items.size());
+            std::move(items.begin(), items.begin() + common, vector.begin() + first);
+            if (common < items.size())
+                vector.insert(vector.begin() + first + common, std::make_move_iterator(items.begin() + common), std::make_move_iterator(items.end()));
+            else
+                vector.erase(vector.begin() + first + common, vector.begin() + last);
+        }
+    }
+
+    IncrementalParser::IncrementalParser(std::string source)
+        : m_source(SourceBuffer::fromString(std::move(source))), m_root(std::make_unique<RootNode>()), m_symbols(std::make_shared<SymbolTable>()),
+          m_reparsed_bytes(0), m_edit{0, 0, 0}, m_top_candidate(nullptr), m_top_candidate_begin(0), m_reused_bytes(0)
+    {
+        m_root->setSymbols(m_symbols);
+        reparse(0, 0);
+    }
+
+    void IncrementalParser::edit(std::size_t offset, std::size_t removed, std::string_view inserted)
+    {
+        std::string_view old_text = m_source->text();
+        if (offset > old_text.size() || removed > old_text.size() - offset)
+            throw std::invalid_argument("The edit is out of the source");
+
+        // the top level statements before the first one whose text, or the character after it,
+        // is touched by the edit are kept. The text after a statement is up to the next one
+        std::size_t low = 0;
+        std::size_t high = m_top_level.size();
+        while (low < high)
+        {
+            std::size_t middle = low + (high - low) / 2;
+            std::size_t next = middle + 1 < m_top_level.size() ? m_top_level[middle + 1].begin : old_text.size();
+            if (next <= offset && m_top_level[middle].end < offset)
+                low = middle + 1;
+            else
+                high = middle;
+        }
+        std::size_t start = low == 0 ? 0 : (low < m_top_level.size() ? m_top_level[low].begin : old_text.size());
+
+        // the new text is copied once, the lexer needs it contiguous
+        std::string text;
+        text.reserve(old_text.size() - removed + inserted.size());
+        text.append(old_text.substr(0, offset));
+        text.append(inserted);
+        text.append(old_text.substr(offset + removed));
+
+        m_source = SourceBuffer::fromString(std::move(text));
+        m_edit = {offset, removed, inserted.size()};
+        reparse(low, start);
+    }
+
+    void IncrementalParser::reparse(std::size_t first, std::size_t start)
+    {
+        auto &children = m_root->m_children;
+        std::size_t count = children.size();
+
+        // the old statements from after on are past the edit: the parse stops when it gets to one of them
+        std::size_t after = first;
+        while (after < count && m_top_level[after].begin < m_edit.offset + m_edit.removed)
+            ++after;
+        std::size_t joined = after;
+        bool rejoined = false;
+        std::size_t stop = m_source->size();
+
+        std::vector<std::unique_ptr<ASTNode>> statements;
+        std::vector<TopLevelSpan> spans;
+        std::vector<Diagnostic> diagnostics;
+        m_reused_bytes = 0;
+
+        Parser parser(m_source, start);
+        parser.m_diagnostics = &diagnostics;
+        parser.m_incremental = this;
+        parser.m_symbols = m_symbols;
+        try
+        {
+            parser.skipUnknownTokens();
+            while (parser.m_current_token.getType() != TokenType::END_OF_FILE)
+            {
+                std::size_t begin = parser.m_current_token.getOffset();
+                while (joined < count && m_top_level[joined].begin - m_edit.removed + m_edit.inserted < begin)
+                    ++joined;
+                if (joined < count && m_top_level[joined].begin - m_edit.removed + m_edit.inserted == begin)
+                {
+                    rejoined = true;
+                    stop = begin;
+                    break;
+                }
+
+                // the old statement in the same place, if it's before the edit
+                std::size_t aligned = first + statements.size();
+                std::size_t moved = 0;
+                m_top_candidate = nullptr;
+                if (aligned < after)
+                {
+                    const TopLevelSpan &old = m_top_level[aligned];
+                    m_top_candidate = static_cast<StatementNode *>(children[aligned].get());
+                    m_top_candidate_begin = old.begin;
+                    if (m_top_candidate && old.clean && isMoved(old.begin, old.end - old.begin, moved) && moved == begin)
+                    {
+                        statements.push_back(std::move(children[aligned]));
+                        spans.push_back({begin, begin + (old.end - old.begin), old.hash, true});
+                        m_reused_bytes += old.end - old.begin;
+                        parser.seek(begin + (old.end - old.begin));
+                        continue;
+                    }
+                }
+
+                std::size_t errors = diagnostics.size();
+                statements.push_back(parser.parseStatement());
+                std::uint64_t hash = RootNode::hashChild(statements.back().get());
+                if (errors == diagnostics.size())
+                {
+                    spans.push_back({begin, parser.m_previous_end, hash, true});
+                    continue;
+                }
+
+                // the errors may depend on the token after the statement (even on the end of the text),
+                // that is part of it too
+                const Token &next = parser.m_current_token;
+                spans.push_back({begin, next.getOffset() + next.getValue().size(), hash, false});
+            }
+        }
+        catch (...)
+        {
+            m_frames.clear();
+            throw;
+        }
+        if (!rejoined)
+            joined = count;
+
+        // diagnostics: the ones before start are kept, the ones of the statements parsed again replaced
+        // and the ones after moved with their text
+        std::size_t old_stop = joined < count ? m_top_level[joined].begin : std::string_view::npos;
+        auto offsetLess = [](const Diagnostic &diagnostic, std::size_t offset)
+        { return diagnostic.offset < offset; };
+        auto kept = std::lower_bound(m_diagnostics.begin(), m_diagnostics.end(), start, offsetLess);
+        auto moved = std::lower_bound(kept, m_diagnostics.end(), old_stop, offsetLess);
+        for (auto diagnostic = moved; diagnostic != m_diagnostics.end(); ++diagnostic)
+            diagnostic->offset = diagnostic->offset - m_edit.removed + m_edit.inserted;
+        auto inserted = m_diagnostics.erase(kept, moved);
+        m_diagnostics.insert(inserted, std::make_move_iterator(diagnostics.begin()), std::make_move_iterator(diagnostics.end()));
+
+        // spans of the statements after the edit
+        if (m_edit.removed != m_edit.inserted)
+            for (std::size_t idx = joined; idx < count; ++idx)
+            {
+                m_top_level[idx].begin = m_top_level[idx].begin - m_edit.removed + m_edit.inserted;
+                m_top_level[idx].end = m_top_level[idx].end - m_edit.removed + m_edit.inserted;
+            }
+        splice(m_top_level, first, joined, spans);
+
+        // the old statements that were parsed again, without the subtrees moved out of them
+        for (std::size_t idx = first; idx < joined; ++idx)
+            forgetSpans(children[idx].get());
+        splice(children, first, joined, statements);
+
+        std::uint64_t hash = RootNode::hashKind(NodeKind::ROOT);
+        for (const auto &span : m_top_level)
+            hash = RootNode::combineHash(hash, span.hash);
+        m_root->setHash(hash);
+
+        m_reparsed_bytes = stop - start - m_reused_bytes;
+    }
+
+    std::unique_ptr<StatementNode> IncrementalParser::takeStatement(std::size_t begin, std::size_t &end)
+    {
+        // the counterpart of a top level statement is given by reparse()
+        StatementNode *old = m_top_candidate;
+        std::size_t old_begin = m_top_candidate_begin;
+
+        if (!m_frames.empty())
+        {
+            Frame &parent = m_frames.back();
+            std::unique_ptr<StatementNode> *slot = parent.old ? slotOf(parent.old, parent.slot++) : nullptr;
+            auto span = slot && *slot ? m_nested.find(slot->get()) : m_nested.end();
+
+            old = nullptr;
+            if (span != m_nested.end())
+            {
+                old = slot->get();
+                old_begin = parent.old_begin + span->second.begin;
+
+                std::size_t moved = 0;
+                if (isMoved(old_begin, span->second.length, moved) && moved == begin)
+                {
+                    span->second.begin = begin - parent.new_begin;
+                    end = begin + span->second.length;
+                    m_reused_bytes += span->second.length;
+                    return std::move(*slot);
+                }
+            }
+        }
+
+        m_frames.push_back({old, old_begin, begin, 0});
+        return nullptr;
+    }
+
+    void IncrementalParser::endStatement(const StatementNode *statement, std::size_t begin, std::size_t end, bool clean)
+    {
+        m_frames.pop_back();
+        if (!statement)
+            return;
+
+        // only the nested statements without errors are recorded, the top level ones are in m_top_level
+        if (clean && !m_frames.empty())
+            m_nested[statement] = {begin - m_frames.back().new_begin, end - begin};
+        else
+            m_nested.erase(statement);
+    }
+
+    bool IncrementalParser::isMoved(std::size_t begin, std::size_t length, std::size_t &moved) const
+    {
+        // the character after the text is looked at by the lexer too
+        if (begin + length < m_edit.offset)
+        {
+            moved = begin;
+            return true;
+        }
+        if (begin >= m_edit.offset + m_edit.removed)
+        {
+            moved = begin - m_edit.removed + m_edit.inserted;
+            return true;
+        }
+        return false;
+    }
+
+    std::unique_ptr<StatementNode> *IncrementalParser::slotOf(StatementNode *parent, std::size_t slot)
+    {
+        switch (parent->getKind())
+        {
+        case NodeKind::IF:
+        {
+            auto *if_node = static_cast<IfNode *>(parent);
+            if (slot == 0)
+                return &if_node->m_then_branch;
+            if (slot == 1)
+                return &if_node->m_else_branch;
+            break;
+        }
+        case NodeKind::WHILE:
+            if (slot == 0)
+                return &static_cast<WhileNode *>(parent)->m_statement;
+            break;
+        default:
+            break;
+        }
+        return nullptr;
+    }
+
+    void IncrementalParser::forgetSpans(const ASTNode *discarded)
+    {
+        std::vector<const ASTNode *> stack{discarded};
+        while (!stack.empty())
+        {
+            const ASTNode *node = stack.back();
+            stack.pop_back();
+            if (!node)
+                continue;
+
+            m_nested.erase(node);
+            if (node->getKind() == NodeKind::IF)
+            {
+                auto *if_node = static_cast<const IfNode *>(node);
+                stack.push_back(if_node->getThenBranch());
+                stack.push_back(if_node->getElseBranch());
+            }
+            else if (node->getKind() == NodeKind::WHILE)
+                stack.push_back(static_cast<const WhileNode *>(node)->getStatement());
+        }
+    }
+}
@@ -1,47 +1,26 @@
 #include "../include/Lexer.hpp"
 #include "Lexer.hpp"
 
+#include <cstring>
+#include <iterator>
+
 namespace WhileParser
 {
-    void Lexer::init(std::unique_ptr<std::istream> source, bool skip_whitespaces, bool skip_eol)
-    {
-
-        m_keywords = std::unordered_map<std::string, TokenType>{
-            {"skip", TokenType::SKIP},
-            {" ", TokenType::WHITESPACE},
-            {"\n", TokenType::END_OF_LINE},
-            {"if", TokenType::IF},
-            {"then", TokenType::THEN},
-            {"else", TokenType::ELSE},
-            {"endif", TokenType::ENDIF},
-            {"while", TokenType::WHILE},
-            {"do", TokenType::DO},
-            {"endwhile", TokenType::ENDWHILE},
-            {"true", TokenType::TRUE},
-            {"false", TokenType::FALSE},
-            {"and", TokenType::AND},
-            {"or", TokenType::OR},
-            {"not", TokenType::NOT},
-            {":=", TokenType::ASSIGN},
-            {"<=", TokenType::LTE},
-            {">=", TokenType::GTE},
-            {";", TokenType::SEMICOLON},
-            {"+", TokenType::PLUS},
-            {"-", TokenType::MINUS},
-            {"<", TokenType::LT},
-            {">", TokenType::GT},
-            {"=", TokenType::EQ},
-            {"(", TokenType::LPAREN},
-            {")", TokenType::RPAREN},
-            {"*", TokenType::WILDCARD},
-            {"/", TokenType::SLASH}};
-
+    void Lexer::init(std::unique_ptr<std::istream> source, bool skip_whitespaces, bool skip_eol, std::size_t chunk_size)
+    {
         m_eof = false;
         m_skip_whitespaces = skip_whitespaces;
         m_skip_eol = skip_eol;
 
-        // initializing my stream with the correct stream
+        // initializing my stream with the correct stream, the chunk is allocated at the first refill
         m_stream = std::move(source);
+        m_source.reset();
+        m_chunk_size = std::max<std::size_t>(chunk_size, 1);
+
+        m_window = nullptr;
+        m_window_offset = 0;
+        m_cursor = nullptr;
+        m_end = nullptr;
     }
 
     Lexer::Lexer(const std::string &filename, bool skip_whitespaces = false, bool skip_eol = false)
@@ -52,106 +31,207 @@ namespace WhileParser
             throw std::invalid_argument("The filename has to be at least 1 charachter and has to have extension .wh");
         }
 
-        auto file = std::make_unique<std::ifstream>(filename);
+        init(nullptr, skip_whitespaces, skip_eol, 0);
 
-        if (!file->is_open())
-        {
-            throw std::runtime_error("Impossible to open the file");
-        }
+        // the whole file is scanned in place, no per-character stream calls
+        setSource(SourceBuffer::map(filename));
+    }
+
+    void Lexer::setSource(std::shared_ptr<const SourceBuffer> source)
+    {
+        m_source = std::move(source);
+        m_window = m_source->begin();
+        m_window_offset = 0;
+        m_cursor = m_source->begin();
+        m_end = m_source->end();
+    }
+
+    void Lexer::reset(std::shared_ptr<const SourceBuffer> source)
+    {
+        init(nullptr, m_skip_whitespaces, m_skip_eol, m_chunk_size);
+        setSource(std::move(source));
+    }
 
-        init(std::move(file), skip_whitespaces, skip_eol);
+    void Lexer::reset(std::unique_ptr<std::istream> raw_code)
+    {
+        // the chunk is kept, with the size it has grown to
+        init(std::move(raw_code), m_skip_whitespaces, m_skip_eol, m_chunk_size);
     }
 
-    bool Lexer::isIdChar(char c) const
+    void Lexer::reset(std::string_view text)
     {
-        return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+        init(nullptr, m_skip_whitespaces, m_skip_eol, m_chunk_size);
+        m_window = text.data();
+        m_cursor = text.data();
+        m_end = text.data() + text.size();
     }
 
-    Token Lexer::readIdentifierOrKeyword(char first)
+    bool Lexer::refill(const char *&token_start)
     {
-        std::string word(1, first);
+        // mapped sources are already whole, streams stop at the first failed read
+        if (!m_stream || !*m_stream)
+            return false;
+
+        std::size_t kept = static_cast<std::size_t>(m_end - token_start);
+        std::size_t cursor = static_cast<std::size_t>(m_cursor - token_start);
 
-        while (m_stream->peek() != EOF && isIdChar(m_stream->peek()))
+        if (!m_chunk)
         {
-            word += static_cast<char>(m_stream->get());
+            m_chunk = std::make_unique<char[]>(m_chunk_size);
         }
-
-        // found a keyword
-        if (auto it = m_keywords.find(word); it != m_keywords.end())
+        else if (kept == m_chunk_size)
         {
-            return {it->second, word};
+            // a single token fills the whole chunk, the buffer has to grow to hold it
+            auto grown = std::make_unique<char[]>(m_chunk_size * 2);
+            std::memcpy(grown.get(), token_start, kept);
+            m_chunk = std::move(grown);
+            m_chunk_size *= 2;
         }
-
-        // check identifier validity
-        if (std::isdigit(word[0]))
+        else if (kept != 0)
         {
-            return {TokenType::UNKNOWN, word};
+            std::memmove(m_chunk.get(), token_start, kept);
         }
 
-        return {TokenType::IDENTIFIER, std::move(word)};
+        m_window_offset += static_cast<std::size_t>(token_start - m_window);
+
+        m_stream->read(m_chunk.get() + kept, static_cast<std::streamsize>(m_chunk_size - kept));
+        std::size_t read = static_cast<std::size_t>(m_stream->gcount());
+
+        m_window = m_chunk.get();
+        token_start = m_window;
+        m_cursor = m_window + cursor;
+        m_end = m_window + kept + read;
+
+        return read != 0;
     }
 
-    Token Lexer::readNumber(char first)
+    Token Lexer::readIdentifierOrKeyword(const char *start)
     {
-        std::string word(1, first);
-        while (std::isdigit(m_stream->peek()))
+        m_cursor = scanIdentifier(m_cursor, m_end);
+        // the identifier may go on in the next chunk
+        while (m_cursor == m_end && refill(start))
+            m_cursor = scanIdentifier(m_cursor, m_end);
+
+        std::string_view word(start, m_cursor - start);
+        std::size_t offset = tokenOffset(start);
+
+        // found a keyword, its value views the static spelling so it outlives the chunk
+        if (TokenType keyword = classifyWord(word); keyword != TokenType::IDENTIFIER)
         {
-            word += static_cast<char>(m_stream->get());
+            return {keyword, tokenSpelling(keyword), offset};
         }
 
-        if (std::isalpha(m_stream->peek()))
+        // check identifier validity
+        if (hasCharClass(word[0], CHAR_DIGIT))
         {
-            word += static_cast<char>(m_stream->get());
-            return {TokenType::UNKNOWN, word};
+            return {TokenType::UNKNOWN, word, offset};
         }
 
-        return {TokenType::NUMBER, std::move(word)};
+        return {TokenType::IDENTIFIER, word, offset};
     }
 
-    Token Lexer::readSymbol(char first)
+    Token Lexer::readNumber(const char *start)
     {
+        m_cursor = scanDigits(m_cursor, m_end);
+        while (m_cursor == m_end && refill(start))
+            m_cursor = scanDigits(m_cursor, m_end);
 
-        std::string word(1, first);
+        if (m_cursor != m_end && hasCharClass(*m_cursor, CHAR_ALPHA))
+        {
+            ++m_cursor;
+            return {TokenType::UNKNOWN, std::string_view(start, m_cursor - start), tokenOffset(start)};
+        }
+
+        // the digits are contiguous even across chunks, refill() keeps the start of the token
+        return {TokenType::NUMBER, std::string_view(start, m_cursor - start), tokenOffset(start), parseNumber(start, m_cursor)};
+    }
+
+    Token Lexer::readSymbol(const char *start)
+    {
+        // the second character of a compound symbol may be in the next chunk
+        if (m_cursor == m_end)
+            refill(start);
 
-        const std::string compound_symbol = {first, static_cast<char>(m_stream->peek())};
         // check for compound symbols :=, >=, <=.
-        // if the next symbol is a whitespace or in general not a = the instruction below will return 0
-        // so we know we're analyzing a single-character symbol
+        // if the next symbol is a whitespace or in general not a = the symbol is a single character
+        std::size_t length;
+        TokenType type = classifySymbol(*start, m_cursor != m_end ? *m_cursor : '\0', length);
+        m_cursor = start + length;
 
-        if (m_keywords.count(compound_symbol))
+        // skipped whitespaces never get here, nextToken() consumes them
+
+        if (type != TokenType::UNKNOWN)
+            return {type, tokenSpelling(type), tokenOffset(start)};
+
+        return {TokenType::UNKNOWN, std::string_view(start, 1), tokenOffset(start)};
+    }
+
+    Token Lexer::nextToken()
+    {
+        // runs of skipped whitespaces and newlines are consumed in a single scan, across chunks
+        if (m_skip_whitespaces || m_skip_eol)
         {
-            word += static_cast<char>(m_stream->get());
+            m_cursor = scanBlanks(m_cursor, m_end, m_skip_whitespaces, m_skip_eol);
+            while (m_cursor == m_end && refill(m_cursor))
+                m_cursor = scanBlanks(m_cursor, m_end, m_skip_whitespaces, m_skip_eol);
         }
 
-        if (auto it = m_keywords.find(word); it != m_keywords.end())
+        // end of the source
+        if (m_cursor == m_end && !refill(m_cursor))
         {
-            // skips whitespaces
-            if ((word == " " && m_skip_whitespaces) || (word == "\n" && m_skip_eol))
-                return nextToken();
-
-            return {it->second, std::move(word)};
+            m_eof = true;
+            return {TokenType::END_OF_FILE, "EOF", tokenOffset(m_end)};
         }
 
-        return {TokenType::UNKNOWN, std::move(word)};
+        const char *start = m_cursor++;
+
+        if (hasCharClass(*start, CHAR_IDENTIFIER_START))
+            return readIdentifierOrKeyword(start);
+        if (hasCharClass(*start, CHAR_DIGIT))
+            return readNumber(start);
+
+        return readSymbol(start);
     }
 
-    Token Lexer::nextToken()
+    void Lexer::seek(std::size_t offset)
     {
+        if (m_stream)
+            throw std::runtime_error("Only an in-memory source can be seeked");
+        if (offset > static_cast<std::size_t>(m_end - m_window))
+            throw std::invalid_argument("Offset out of the source");
+
+        m_cursor = m_window + offset;
+        m_eof = false;
+    }
 
-        char c;
-        // empty file
-        if (!m_stream->get(c))
+    TokenStream Lexer::tokenizeAll()
+    {
+        if (!m_source)
         {
-            m_eof = true;
-            return {TokenType::END_OF_FILE, "EOF"};
+            // the characters already in the chunk (or the viewed text) come first, then the rest of the stream
+            std::string text = m_cursor ? std::string(m_cursor, m_end) : std::string();
+            if (m_stream)
+                text.append(std::istreambuf_iterator<char>(*m_stream), std::istreambuf_iterator<char>());
+
+            setSource(SourceBuffer::fromString(std::move(text)));
+            m_stream.reset();
+            m_chunk.reset();
         }
 
-        if (std::isalpha(c) || c == '_')
-            return readIdentifierOrKeyword(c);
-        if (std::isdigit(c))
-            return readNumber(c);
+        TokenStream tokens(m_source);
+        // a token every few characters on average, to avoid most of the reallocations
+        tokens.reserve(static_cast<std::size_t>(m_end - m_cursor) / 4 + 1);
 
-        return readSymbol(c);
+        while (true)
+        {
+            Token token = nextToken();
+            if (token.getType() == TokenType::END_OF_FILE)
+            {
+                tokens.push(TokenType::END_OF_FILE, token.getOffset(), 0);
+                return tokens;
+            }
+            tokens.push(token.getType(), token.getOffset(), static_cast<std::uint32_t>(token.getValue().size()));
+        }
     }
 
     bool Lexer::isTokenAvailable()
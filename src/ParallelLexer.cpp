@@ -0,0 +1,71 @@
+#include "../include/ParallelLexer.hpp"
+
+#include <algorithm>
+#include <thread>
+
+namespace WhileParser
+{
+    ParallelLexer::ParallelLexer(std::shared_ptr<const SourceBuffer> source, bool skip_whitespaces, bool skip_eol, unsigned threads)
+        : m_source(std::move(source)), m_skip_whitespaces(skip_whitespaces), m_skip_eol(skip_eol),
+          m_threads(threads != 0 ? threads : std::max(1u, std::thread::hardware_concurrency()))
+    {
+    }
+
+    std::vector<std::size_t> ParallelLexer::splitPoints() const
+    {
+        std::size_t size = m_source->size();
+        std::size_t pieces = std::min<std::size_t>(m_threads, std::max<std::size_t>(size / MIN_CHUNK_SIZE, 1));
+
+        std::vector<std::size_t> points{0};
+        const char *begin = m_source->begin();
+        for (std::size_t idx = 1; idx < pieces; ++idx)
+        {
+            // move the ideal cut forward to the next whitespace or newline, that starts the next piece
+            const char *cut = std::max(begin + idx * size / pieces, begin + points.back());
+            cut = std::find_if(cut, m_source->end(), [](char c)
+                               { return c == ' ' || c == '\n'; });
+            if (cut == m_source->end())
+                break;
+            if (static_cast<std::size_t>(cut - begin) > points.back())
+                points.push_back(static_cast<std::size_t>(cut - begin));
+        }
+        points.push_back(size);
+
+        return points;
+    }
+
+    TokenStream ParallelLexer::tokenizeAll()
+    {
+        std::vector<std::size_t> points = splitPoints();
+        std::size_t pieces = points.size() - 1;
+
+        std::vector<TokenStream> partial(pieces, TokenStream(m_source));
+        auto lexPiece = [this, &points, &partial](std::size_t idx)
+        {
+            Lexer lexer(m_source, points[idx], points[idx + 1], m_skip_whitespaces, m_skip_eol);
+            partial[idx] = lexer.tokenizeAll();
+        };
+
+        std::vector<std::thread> workers;
+        for (std::size_t idx = 1; idx < pieces; ++idx)
+            workers.emplace_back(lexPiece, idx);
+        lexPiece(0);
+        for (auto &worker : workers)
+            worker.join();
+
+        // every piece ends with its own END_OF_FILE, only the one of the last piece is kept
+        std::size_t total = 1;
+        for (const auto &piece : partial)
+            total += piece.size() - 1;
+
+        TokenStream tokens(m_source);
+        tokens.reserve(total);
+        for (std::size_t idx = 0; idx < pieces; ++idx)
+        {
+            std::size_t last = idx + 1 == pieces ? partial[idx].size() : partial[idx].size() - 1;
+            tokens.append(partial[idx], 0, last);
+        }
+
+        return tokens;
+    }
+}
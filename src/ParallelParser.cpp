@@ -0,0 +1,149 @@
+#include "../include/ParallelParser.hpp"
+
+#include <algorithm>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+
+namespace WhileParser
+{
+    ParallelParser::ParallelParser(const TokenStream &tokens, unsigned threads)
+        : m_tokens(tokens), m_threads(threads != 0 ? threads : std::max(1u, std::thread::hardware_concurrency())),
+          m_mode(ParseMode::RECURSIVE_DESCENT)
+    {
+    }
+
+    std::vector<std::size_t> ParallelParser::splitPoints() const
+    {
+        std::size_t last = m_tokens.size() - 1;
+        std::size_t pieces = std::min<std::size_t>(m_threads, std::max<std::size_t>(last / MIN_PIECE_TOKENS, 1));
+        const std::vector<TokenType> &types = m_tokens.getTypes();
+
+        // a top level statement ends with a ; or a skip out of every if/while, or with the
+        // endif/endwhile that closes the outermost one. The piece starts after it
+        std::vector<std::size_t> points{0};
+        std::size_t cut = last / pieces;
+        std::size_t depth = 0;
+        for (std::size_t idx = 0; idx + 1 < last && points.size() < pieces; ++idx)
+        {
+            bool end = false;
+            switch (types[idx])
+            {
+            case TokenType::IF:
+            case TokenType::WHILE:
+                ++depth;
+                break;
+            case TokenType::ENDIF:
+            case TokenType::ENDWHILE:
+                if (depth > 0)
+                    --depth;
+                end = depth == 0;
+                break;
+            case TokenType::SEMICOLON:
+            case TokenType::SKIP:
+                end = depth == 0;
+                break;
+            default:
+                break;
+            }
+
+            if (end && idx + 1 >= cut)
+            {
+                // the parser skips the newlines, a piece starts at a token it stops on
+                std::size_t point = idx + 1;
+                while (point < last && types[point] == TokenType::END_OF_LINE)
+                    ++point;
+                if (point == last)
+                    break;
+                points.push_back(point);
+                cut = last * points.size() / pieces;
+            }
+        }
+        points.push_back(last);
+
+        return points;
+    }
+
+    std::unique_ptr<RootNode> ParallelParser::parse()
+    {
+        std::vector<std::size_t> points = splitPoints();
+        std::size_t pieces = points.size() - 1;
+
+        std::vector<std::vector<std::unique_ptr<StatementNode>>> statements(pieces);
+        std::vector<std::exception_ptr> errors(pieces);
+        std::vector<std::size_t> ends(pieces);
+
+        // the pieces share the symbol table, so the slots are the ones of a sequential parse. The identifiers
+        // are interned here in the order they appear, the threads then only look them up
+        auto symbols = std::make_shared<SymbolTable>();
+        const std::vector<TokenType> &types = m_tokens.getTypes();
+        for (std::size_t idx = 0; idx < types.size(); ++idx)
+            if (types[idx] == TokenType::IDENTIFIER)
+                symbols->intern(m_tokens.getValue(idx));
+
+        auto parsePiece = [this, &points, &statements, &errors, &ends, &symbols](std::size_t idx)
+        {
+            try
+            {
+                Parser parser(m_tokens);
+                parser.m_mode = m_mode;
+                parser.m_symbols = symbols;
+                parser.m_next_token = points[idx];
+                parser.nextToken();
+                parser.skipUnknownTokens();
+
+                // the index of the current token is the one before m_next_token, but for END_OF_FILE
+                while (parser.m_current_token.getType() != TokenType::END_OF_FILE && parser.m_next_token - 1 < points[idx + 1])
+                    statements[idx].push_back(m_mode == ParseMode::EXPLICIT_STACK ? parser.parseStatementWithStack() : parser.parseStatement());
+
+                ends[idx] = parser.m_current_token.getType() == TokenType::END_OF_FILE ? m_tokens.size() - 1 : parser.m_next_token - 1;
+            }
+            catch (...)
+            {
+                errors[idx] = std::current_exception();
+            }
+        };
+
+        std::vector<std::thread> workers;
+        for (std::size_t idx = 1; idx < pieces; ++idx)
+            workers.emplace_back(parsePiece, idx);
+        parsePiece(0);
+        for (auto &worker : workers)
+            worker.join();
+
+        // the pieces before the first error ended where the next one starts, so the
+        // parse gets to the error as parse() would
+        for (std::size_t idx = 0; idx < pieces; ++idx)
+        {
+            if (errors[idx])
+            {
+                try
+                {
+                    std::rethrow_exception(errors[idx]);
+                }
+                catch (const std::invalid_argument &exception)
+                {
+                    std::cerr << exception.what() << std::endl;
+                    throw;
+                }
+            }
+
+            // a statement that goes past the end of its piece can't be valid, but if it was
+            // the pieces after it are not made of whole statements: no shortcut then
+            if (ends[idx] != points[idx + 1])
+            {
+                Parser parser(m_tokens);
+                parser.setParseMode(m_mode);
+                return parser.parse();
+            }
+        }
+
+        auto root = std::make_unique<RootNode>();
+        root->setSymbols(symbols);
+        for (auto &piece : statements)
+            for (auto &statement : piece)
+                root->addNode(std::move(statement));
+        return root;
+    }
+}
@@ -0,0 +1,219 @@
+#include "../include/ParseCache.hpp"
+#include "../include/Parser.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+#include <unistd.h>
+
+namespace WhileParser
+{
+    namespace
+    {
+        namespace fs = std::filesystem;
+
+        inline std::uint64_t rotate(std::uint64_t value, int bits)
+        {
+            return (value << bits) | (value >> (64 - bits));
+        }
+
+        // 8 bytes per step: the source is hashed at memory speed next to the cost of lexing it
+        std::uint64_t hashBytes(std::string_view bytes)
+        {
+            constexpr std::uint64_t K1 = 0x9E3779B185EBCA87ull;
+            constexpr std::uint64_t K2 = 0xC2B2AE3D27D4EB4Full;
+
+            std::uint64_t hash = bytes.size() * K1;
+            std::size_t idx = 0;
+            for (; idx + 8 <= bytes.size(); idx += 8)
+            {
+                std::uint64_t word;
+                std::memcpy(&word, bytes.data() + idx, 8);
+                hash = rotate(hash ^ (word * K2), 31) * K1;
+            }
+
+            // the data of an empty source can be null, that memcpy doesn't take even for 0 bytes
+            std::uint64_t tail = 0;
+            if (idx < bytes.size())
+                std::memcpy(&tail, bytes.data() + idx, bytes.size() - idx);
+            hash = rotate(hash ^ (tail * K2), 31) * K1;
+
+            hash ^= hash >> 33;
+            hash *= K2;
+            hash ^= hash >> 29;
+            return hash;
+        }
+    }
+
+    ParseCache::ParseCache(const std::string &directory, std::uintmax_t max_bytes)
+        : m_directory(directory), m_max_bytes(max_bytes), m_hits(0), m_misses(0), m_temporaries(0)
+    {
+        fs::create_directories(m_directory);
+    }
+
+    std::unique_ptr<RootNode> ParseCache::parse(const std::string &filename)
+    {
+        auto source = openSource(filename);
+        std::string key = keyOf(source->text());
+        if (auto flat = find(key))
+            return flat->toTree();
+
+        auto root = Parser(source).parse();
+        store(key, FlatAST::fromTree(*root));
+        return root;
+    }
+
+    FlatAST ParseCache::parseFlat(const std::string &filename)
+    {
+        auto source = openSource(filename);
+        std::string key = keyOf(source->text());
+        if (auto flat = find(key))
+            return std::move(*flat);
+
+        auto flat = FlatAST::fromTree(*Parser(source).parse());
+        store(key, flat);
+        return flat;
+    }
+
+    std::shared_ptr<const SourceBuffer> ParseCache::openSource(const std::string &filename)
+    {
+        if (filename.size() < 4 || filename.substr(filename.size() - 3, 3) != ".wh")
+            throw std::invalid_argument("The filename has to be at least 1 charachter and has to have extension .wh");
+        return SourceBuffer::map(filename);
+    }
+
+    std::string ParseCache::keyOf(std::string_view source)
+    {
+        char key[64];
+        std::snprintf(key, sizeof(key), "%016llx-%llx-g%uv%u.wast", static_cast<unsigned long long>(hashBytes(source)),
+                      static_cast<unsigned long long>(source.size()), GRAMMAR_VERSION, FlatAST::FORMAT_VERSION);
+        return key;
+    }
+
+    std::optional<FlatAST> ParseCache::find(const std::string &key)
+    {
+        fs::path path = m_directory / key;
+        std::error_code error;
+        if (!fs::exists(path, error))
+        {
+            ++m_misses;
+            return std::nullopt;
+        }
+
+        try
+        {
+            FlatAST flat = FlatAST::load(path.string());
+            // a hit makes the entry the most recently used one
+            fs::last_write_time(path, fs::file_time_type::clock::now(), error);
+            ++m_hits;
+            return flat;
+        }
+        catch (const std::exception &)
+        {
+            // evicted in the meantime, or not a valid entry: it is parsed again and replaced
+            ++m_misses;
+            return std::nullopt;
+        }
+    }
+
+    void ParseCache::store(const std::string &key, const FlatAST &flat)
+    {
+        std::size_t temporary;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            temporary = m_temporaries++;
+        }
+
+        // the name of the temporary file is unique among the processes and the threads
+        fs::path target = m_directory / key;
+        fs::path written = m_directory / (key + ".tmp." + std::to_string(::getpid()) + "." + std::to_string(temporary));
+        std::error_code error;
+        try
+        {
+            flat.save(written.string());
+        }
+        catch (const std::exception &)
+        {
+            fs::remove(written, error);
+            return;
+        }
+
+        // the rename replaces the entry at once, a reader maps either the old file or the new one
+        std::uintmax_t size = fs::file_size(written, error);
+        fs::rename(written, target, error);
+        if (error)
+        {
+            fs::remove(written, error);
+            return;
+        }
+
+        bool full;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_bytes)
+                *m_bytes += size;
+            full = !m_bytes || *m_bytes > m_max_bytes;
+        }
+        if (full)
+            evict();
+    }
+
+    void ParseCache::evict()
+    {
+        struct Entry
+        {
+            fs::path path;
+            fs::file_time_type time;
+            std::uintmax_t size;
+        };
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        std::vector<Entry> entries;
+        std::uintmax_t total = 0;
+        auto now = fs::file_time_type::clock::now();
+
+        // other processes add and remove files meanwhile, those that vanish are skipped
+        std::error_code error;
+        for (fs::directory_iterator entry(m_directory, error), end; !error && entry != end; entry.increment(error))
+        {
+            std::error_code stat_error;
+            if (!entry->is_regular_file(stat_error))
+                continue;
+            fs::file_time_type time = entry->last_write_time(stat_error);
+            std::uintmax_t size = entry->file_size(stat_error);
+            if (stat_error)
+                continue;
+
+            // a temporary file that old belongs to a writer that died
+            if (entry->path().filename().string().find(".tmp.") != std::string::npos)
+            {
+                if (now - time > std::chrono::hours(1))
+                    fs::remove(entry->path(), stat_error);
+                continue;
+            }
+            if (entry->path().extension() != ".wast")
+                continue;
+
+            entries.push_back({entry->path(), time, size});
+            total += size;
+        }
+
+        if (total > m_max_bytes)
+        {
+            std::sort(entries.begin(), entries.end(), [](const Entry &left, const Entry &right)
+                      { return left.time < right.time; });
+            for (const auto &entry : entries)
+            {
+                if (total <= m_max_bytes / 4 * 3)
+                    break;
+                if (fs::remove(entry.path, error))
+                    total -= entry.size;
+            }
+        }
+        m_bytes = total;
+    }
+}
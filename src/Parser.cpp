@@ -1,42 +1,158 @@
 #include "../include/Parser.hpp"
+#include "../include/IncrementalParser.hpp"
 #include "Parser.hpp"
 
+#include <atomic>
+
 namespace WhileParser
 {
+    namespace
+    {
+        // takes the node on top of the stack, that the grammar guarantees to be a T
+        template <typename T>
+        std::unique_ptr<T> pop(std::vector<std::unique_ptr<ASTNode>> &stack)
+        {
+            std::unique_ptr<T> node(static_cast<T *>(stack.back().release()));
+            stack.pop_back();
+            return node;
+        }
+    }
 
     std::unique_ptr<RootNode> Parser::parse()
     {
 
         auto root = std::make_unique<RootNode>();
+        root->setSymbols(m_symbols);
+        parseStatements([&root](std::unique_ptr<StatementNode> statementNode)
+                        { root->addNode(std::move(statementNode)); });
+
+        return std::move(root);
+    }
+
+    std::size_t Parser::parseEach(const std::function<void(const StatementNode &)> &callback)
+    {
+        std::size_t count = 0;
+        parseStatements([&callback, &count](std::unique_ptr<StatementNode> statementNode)
+                        {
+                            ++count;
+                            callback(*statementNode); });
+
+        return count;
+    }
+
+    void Parser::parseStatements(const std::function<void(std::unique_ptr<StatementNode>)> &sink)
+    {
         try
         {
-            while (m_lexer.isTokenAvailable())
+            m_open_blocks = 0;
+            skipUnknownTokens();
+            while (m_current_token.getType() != TokenType::END_OF_FILE)
             {
                 // at the level 1 of the AST it's only possible to have Statements
-                auto statementNode = parseStatement();
-                root->addNode(std::move(statementNode));
+                sink(m_mode == ParseMode::EXPLICIT_STACK ? parseStatementWithStack() : parseStatement());
             }
         }
-        catch (std::invalid_argument exception)
+        catch (const std::invalid_argument &exception)
         {
             std::cerr << exception.what() << std::endl;
-            throw exception; // to catch in the entrypoint
+            throw; // to catch in the entrypoint
         }
+    }
 
-        return std::move(root);
+    ParseResult Parser::parseWithDiagnostics()
+    {
+        ParseResult result;
+        m_diagnostics = &result.diagnostics;
+        m_panic = false;
+
+        try
+        {
+            result.root = parse();
+        }
+        catch (...)
+        {
+            // only the errors that are not syntax errors, e.g. the ones of the input stream
+            m_diagnostics = nullptr;
+            throw;
+        }
+
+        m_diagnostics = nullptr;
+        // the statements with errors are holes in the tree
+        if (!result.ok())
+            result.root.reset();
+        return result;
+    }
+
+    ArenaTree Parser::parseInArena(bool hash_consing)
+    {
+        auto arena = std::make_unique<Arena>();
+        // if parse() throws, the nodes built so far are released with the arena
+        ArenaScope scope(arena.get());
+
+        // sharing subtrees is only safe in an arena, whose nodes are never deleted one by one
+        m_hash_consing = hash_consing;
+        m_subtrees.clear();
+
+        RootNode *root = nullptr;
+        try
+        {
+            root = parse().release();
+        }
+        catch (...)
+        {
+            m_hash_consing = false;
+            m_subtrees.clear();
+            throw;
+        }
+
+        m_hash_consing = false;
+        m_subtrees.clear();
+        return ArenaTree(std::move(arena), root);
     }
 
     std::unique_ptr<StatementNode> Parser::parseStatement()
+    {
+        std::size_t begin = m_current_token.getOffset();
+        if (m_incremental)
+        {
+            // a statement whose text the edit didn't touch is not parsed again
+            std::size_t end = 0;
+            if (auto reused = m_incremental->takeStatement(begin, end))
+            {
+                seek(end);
+                return reused;
+            }
+        }
+
+        std::size_t open_blocks = m_open_blocks;
+        std::size_t errors = m_diagnostics ? m_diagnostics->size() : 0;
+        auto statementNode = dispatchStatement();
+
+        // a statement with an error is left out of the tree
+        if (m_panic)
+        {
+            recover(open_blocks);
+            statementNode = nullptr;
+        }
+
+        if (m_incremental)
+            m_incremental->endStatement(statementNode.get(), begin, m_previous_end, errors == m_diagnostics->size());
+        return statementNode;
+    }
+
+    std::unique_ptr<StatementNode> Parser::dispatchStatement()
     {
 
         if (m_current_token.getType() == TokenType::WHILE)
         {
             advance();
+            ++m_open_blocks;
             return parseWhileStatement();
         }
         if (m_current_token.getType() == TokenType::IF)
         {
             advance();
+            ++m_open_blocks;
             return parseIfStatement();
         }
         if (m_current_token.getType() == TokenType::SKIP)
@@ -50,38 +166,57 @@ namespace WhileParser
         }
 
         // placeholder
-        throw std::invalid_argument("The syntax is not correct");
+        error("The syntax is not correct");
+        return nullptr;
     }
 
     std::unique_ptr<AssignmentNode> Parser::parseAssignmentStatement()
     {
         std::unique_ptr<ExpressionNode> leftExpressionNode = nullptr;
 
-        auto identifier = consume(TokenType::IDENTIFIER, "Expected IDENTIFIER").getValue();
+        // the token only views its lexeme, the node views the copy in the symbol table
+        std::uint32_t slot = m_symbols->intern(m_current_token.getValue());
+        if (!consume(TokenType::IDENTIFIER, "Expected IDENTIFIER"))
+            return nullptr;
 
-        consume(TokenType::ASSIGN, "Expected ASSIGN");
+        if (!consume(TokenType::ASSIGN, "Expected ASSIGN"))
+            return nullptr;
 
         leftExpressionNode = parseExpression();
+        if (m_panic)
+            return nullptr;
 
-        consume(TokenType::SEMICOLON, "Expected SEMICOLON");
+        if (!consume(TokenType::SEMICOLON, "Expected SEMICOLON"))
+            return nullptr;
 
-        return std::move(std::make_unique<AssignmentNode>(identifier, std::move(leftExpressionNode)));
+        return std::move(std::make_unique<AssignmentNode>(slot, m_symbols->getName(slot), std::move(leftExpressionNode)));
     }
 
     std::unique_ptr<IfNode> Parser::parseIfStatement()
     {
 
         auto predicateNode = parsePredicate();
+        if (m_panic)
+            return nullptr;
 
-        consume(TokenType::THEN, "Expected THEN");
+        if (!consume(TokenType::THEN, "Expected THEN"))
+            return nullptr;
 
         auto thenStatementNode = parseStatement();
 
-        consume(TokenType::ELSE, "Expected ELSE");
+        if (!consume(TokenType::ELSE, "Expected ELSE"))
+            return nullptr;
 
         auto elseStatementNode = parseStatement();
 
-        consume(TokenType::ENDIF, "Expected ENDIF");
+        if (!consume(TokenType::ENDIF, "Expected ENDIF"))
+            return nullptr;
+        --m_open_blocks;
+
+        // a branch with an error was already reported and skipped: the if is parsed to its end
+        // to find the errors after it, but it's left out of the tree as a whole
+        if (!thenStatementNode || !elseStatementNode)
+            return nullptr;
 
         return std::move(std::make_unique<IfNode>(std::move(predicateNode),
                                                   std::move(thenStatementNode), std::move(elseStatementNode)));
@@ -91,12 +226,21 @@ namespace WhileParser
     {
 
         auto predicateNode = parsePredicate();
+        if (m_panic)
+            return nullptr;
 
-        consume(TokenType::DO, "Expected DO");
+        if (!consume(TokenType::DO, "Expected DO"))
+            return nullptr;
 
         auto statementNode = parseStatement();
 
-        consume(TokenType::ENDWHILE, "Expected ENDWHILE");
+        if (!consume(TokenType::ENDWHILE, "Expected ENDWHILE"))
+            return nullptr;
+        --m_open_blocks;
+
+        // same as a branch of an if
+        if (!statementNode)
+            return nullptr;
 
         return std::move(std::make_unique<WhileNode>(
             std::move(predicateNode), std::move(statementNode)));
@@ -105,17 +249,20 @@ namespace WhileParser
     std::unique_ptr<PredicateNode> Parser::parseBooleanPredicate()
     {
 
-        auto leftPredicate = std::make_unique<PredicateNode>(m_current_token.getValue());
+        auto leftPredicate = makePredicate(m_current_token.getType());
         advance();
 
         if ((m_current_token.getType() == TokenType::AND ||
              m_current_token.getType() == TokenType::OR))
         {
 
-            auto op = m_current_token.getValue();
+            TokenType op = m_current_token.getType();
             advance();
 
-            return std::move(std::make_unique<BooleanPredicateNode>(op, std::move(leftPredicate), parsePredicate()));
+            auto rightPredicate = parsePredicate();
+            if (m_panic)
+                return nullptr;
+            return std::move(makeBooleanPredicate(op, std::move(leftPredicate), std::move(rightPredicate)));
         }
 
         // epsilon case
@@ -126,13 +273,17 @@ namespace WhileParser
     {
 
         auto leftMulDivExpression = parseMulDivExpression();
+        if (m_panic)
+            return nullptr;
 
         while (m_current_token.getType() == TokenType::PLUS || m_current_token.getType() == TokenType::MINUS)
         {
-            auto op = m_current_token;
+            TokenType op = m_current_token.getType();
             advance();
             auto rightMulDivExpression = parseMulDivExpression();
-            leftMulDivExpression = std::make_unique<MathExpressionNode>(op.getValue(), std::move(leftMulDivExpression), std::move(rightMulDivExpression));
+            if (m_panic)
+                return nullptr;
+            leftMulDivExpression = makeMathExpression(op, std::move(leftMulDivExpression), std::move(rightMulDivExpression));
         }
 
         return std::move(leftMulDivExpression);
@@ -142,13 +293,17 @@ namespace WhileParser
     {
 
         auto leftExpression = parsePrimaryExpression();
+        if (m_panic)
+            return nullptr;
 
         while (m_current_token.getType() == TokenType::WILDCARD || m_current_token.getType() == TokenType::SLASH)
         {
-            auto op = m_current_token.getValue();
+            TokenType op = m_current_token.getType();
             advance();
             auto rightExpression = parsePrimaryExpression();
-            leftExpression = std::make_unique<MathExpressionNode>(op, std::move(leftExpression), std::move(rightExpression));
+            if (m_panic)
+                return nullptr;
+            leftExpression = makeMathExpression(op, std::move(leftExpression), std::move(rightExpression));
         }
 
         return std::move(leftExpression);
@@ -161,24 +316,29 @@ namespace WhileParser
         {
             advance();
             auto expressionNode = parseExpression();
-            consume(TokenType::RPAREN, "Expected RPAREN");
+            if (m_panic || !consume(TokenType::RPAREN, "Expected RPAREN"))
+                return nullptr;
             return std::move(expressionNode);
         }
 
         if (m_current_token.getType() == TokenType::IDENTIFIER || m_current_token.getType() == TokenType::NUMBER)
         {
 
-            auto token = m_current_token;
+            // the node copies the lexeme before the lookahead moves past it
+            auto expressionNode = makeTerminalExpression(m_current_token);
             advance();
-            return std::move(std::make_unique<ExpressionNode>(token.getValue()));
+            return std::move(expressionNode);
         }
 
-        throw std::invalid_argument("The EXPRESSION is malformed: expected IDENTIFIER/NUMBER, got " + m_current_token.getTokenTypeString());
+        error("The EXPRESSION is malformed: expected IDENTIFIER/NUMBER, got " + m_current_token.getTokenTypeString());
+        return nullptr;
     }
 
     std::unique_ptr<RelationalPredicateNode> Parser::parseRelationalPredicate()
     {
         auto leftExpression = parseExpression();
+        if (m_panic)
+            return nullptr;
 
         if (m_current_token.getType() == TokenType::GTE ||
             m_current_token.getType() == TokenType::GT ||
@@ -186,25 +346,32 @@ namespace WhileParser
             m_current_token.getType() == TokenType::LT ||
             m_current_token.getType() == TokenType::LTE)
         {
-            auto op = m_current_token.getValue();
+            TokenType op = m_current_token.getType();
             advance();
             auto rightExpression = parseExpression();
-            return std::make_unique<RelationalPredicateNode>(op, std::move(leftExpression), std::move(rightExpression));
+            if (m_panic)
+                return nullptr;
+            return makeRelationalPredicate(op, std::move(leftExpression), std::move(rightExpression));
         }
 
-        throw std::invalid_argument("Expected relational operator after expression, got: " + m_current_token.getValue());
+        error("Expected relational operator after expression, got: " + std::string(m_current_token.getValue()));
+        return nullptr;
     }
 
     std::unique_ptr<PredicateNode> Parser::parsePredicate()
     {
         auto leftNode = parseAndPredicate();
+        if (m_panic)
+            return nullptr;
 
         while (m_current_token.getType() == TokenType::OR)
         {
-            auto op = m_current_token.getValue();
+            TokenType op = m_current_token.getType();
             advance();
             auto rightNode = parseAndPredicate();
-            leftNode = std::make_unique<BooleanPredicateNode>(op, std::move(leftNode), std::move(rightNode));
+            if (m_panic)
+                return nullptr;
+            leftNode = makeBooleanPredicate(op, std::move(leftNode), std::move(rightNode));
         }
         return leftNode;
     }
@@ -212,13 +379,17 @@ namespace WhileParser
     std::unique_ptr<PredicateNode> Parser::parseAndPredicate()
     {
         auto leftNode = parseUnaryPredicate();
+        if (m_panic)
+            return nullptr;
 
         while (m_current_token.getType() == TokenType::AND)
         {
-            auto op = m_current_token.getValue();
+            TokenType op = m_current_token.getType();
             advance();
             auto rightNode = parseUnaryPredicate();
-            leftNode = std::make_unique<BooleanPredicateNode>(op, std::move(leftNode), std::move(rightNode));
+            if (m_panic)
+                return nullptr;
+            leftNode = makeBooleanPredicate(op, std::move(leftNode), std::move(rightNode));
         }
         return leftNode;
     }
@@ -228,7 +399,10 @@ namespace WhileParser
         if (m_current_token.getType() == TokenType::NOT)
         {
             advance();
-            return std::make_unique<NotPredicateNode>(parseUnaryPredicate());
+            auto predicate = parseUnaryPredicate();
+            if (m_panic)
+                return nullptr;
+            return makeNotPredicate(std::move(predicate));
         }
         return parsePrimaryPredicate();
     }
@@ -237,44 +411,589 @@ namespace WhileParser
     {
         if (m_current_token.getType() == TokenType::TRUE || m_current_token.getType() == TokenType::FALSE)
         {
-            auto val = m_current_token.getValue();
+            auto node = makePredicate(m_current_token.getType());
             advance();
-            return std::make_unique<PredicateNode>(val);
+            return node;
         }
 
         if (m_current_token.getType() == TokenType::LPAREN)
         {
             advance();
             auto node = parsePredicate();
-            consume(TokenType::RPAREN, "Expected ')' after boolean expression");
+            if (m_panic || !consume(TokenType::RPAREN, "Expected ')' after boolean expression"))
+                return nullptr;
             return node;
         }
 
         return parseRelationalPredicate();
     }
 
+    std::unique_ptr<StatementNode> Parser::parseStatementWithStack()
+    {
+        m_frames.push_back({Step::STATEMENT});
+        try
+        {
+            runSteps();
+        }
+        catch (...)
+        {
+            // the nodes of an arena must go before the arena does
+            m_frames.clear();
+            m_values.clear();
+            m_statements.clear();
+            throw;
+        }
+        return pop<StatementNode>(m_values);
+    }
+
+    void Parser::runSteps()
+    {
+        // a step that needs a nonterminal pushes the step to run after it and then the nonterminal,
+        // whose node ends up on top of m_values: a reduce step pops its operands from there
+        while (!m_frames.empty())
+        {
+            Frame frame = m_frames.back();
+            m_frames.pop_back();
+            TokenType type = m_current_token.getType();
+
+            switch (frame.step)
+            {
+            case Step::STATEMENT:
+                m_statements.push_back({m_values.size(), m_open_blocks});
+                m_frames.push_back({Step::STATEMENT_END});
+
+                if (type == TokenType::WHILE)
+                {
+                    advance();
+                    ++m_open_blocks;
+                    m_frames.push_back({Step::WHILE_DO});
+                    m_frames.push_back({Step::PREDICATE});
+                }
+                else if (type == TokenType::IF)
+                {
+                    advance();
+                    ++m_open_blocks;
+                    m_frames.push_back({Step::IF_THEN});
+                    m_frames.push_back({Step::PREDICATE});
+                }
+                else if (type == TokenType::SKIP)
+                {
+                    advance();
+                    m_values.push_back(std::make_unique<SkipNode>());
+                }
+                else if (type == TokenType::IDENTIFIER)
+                {
+                    // the token only views its lexeme, the node views the copy in the symbol table
+                    m_frames.push_back({Step::ASSIGNMENT_END, TokenType::UNKNOWN, m_symbols->intern(m_current_token.getValue())});
+                    if (consume(TokenType::IDENTIFIER, "Expected IDENTIFIER") && consume(TokenType::ASSIGN, "Expected ASSIGN"))
+                        m_frames.push_back({Step::EXPRESSION});
+                }
+                else
+                    error("The syntax is not correct");
+                break;
+            case Step::STATEMENT_END:
+                m_statements.pop_back();
+                break;
+            case Step::ASSIGNMENT_END:
+            {
+                if (!consume(TokenType::SEMICOLON, "Expected SEMICOLON"))
+                    break;
+                auto expression = pop<ExpressionNode>(m_values);
+                m_values.push_back(std::make_unique<AssignmentNode>(frame.slot, m_symbols->getName(frame.slot), std::move(expression)));
+                break;
+            }
+            case Step::IF_THEN:
+                if (!consume(TokenType::THEN, "Expected THEN"))
+                    break;
+                m_frames.push_back({Step::IF_ELSE});
+                m_frames.push_back({Step::STATEMENT});
+                break;
+            case Step::IF_ELSE:
+                if (!consume(TokenType::ELSE, "Expected ELSE"))
+                    break;
+                m_frames.push_back({Step::IF_END});
+                m_frames.push_back({Step::STATEMENT});
+                break;
+            case Step::IF_END:
+            {
+                if (!consume(TokenType::ENDIF, "Expected ENDIF"))
+                    break;
+                --m_open_blocks;
+                auto else_branch = pop<StatementNode>(m_values);
+                auto then_branch = pop<StatementNode>(m_values);
+                auto condition = pop<PredicateNode>(m_values);
+                // a branch with an error leaves the whole if out of the tree, as in parseIfStatement()
+                if (!then_branch || !else_branch)
+                    m_values.push_back(nullptr);
+                else
+                    m_values.push_back(std::make_unique<IfNode>(std::move(condition), std::move(then_branch), std::move(else_branch)));
+                break;
+            }
+            case Step::WHILE_DO:
+                if (!consume(TokenType::DO, "Expected DO"))
+                    break;
+                m_frames.push_back({Step::WHILE_END});
+                m_frames.push_back({Step::STATEMENT});
+                break;
+            case Step::WHILE_END:
+            {
+                if (!consume(TokenType::ENDWHILE, "Expected ENDWHILE"))
+                    break;
+                --m_open_blocks;
+                auto statement = pop<StatementNode>(m_values);
+                auto condition = pop<PredicateNode>(m_values);
+                if (!statement)
+                    m_values.push_back(nullptr);
+                else
+                    m_values.push_back(std::make_unique<WhileNode>(std::move(condition), std::move(statement)));
+                break;
+            }
+
+            // Expression ::= MulDivExpression (('+' | '-') MulDivExpression)*
+            case Step::EXPRESSION:
+                m_frames.push_back({Step::EXPRESSION_OPERATOR});
+                m_frames.push_back({Step::MUL_DIV_EXPRESSION});
+                break;
+            case Step::EXPRESSION_OPERATOR:
+                if (type == TokenType::PLUS || type == TokenType::MINUS)
+                {
+                    // operators view their static spelling, they stay valid after advance()
+                    m_frames.push_back({Step::EXPRESSION_REDUCE, m_current_token.getType()});
+                    m_frames.push_back({Step::MUL_DIV_EXPRESSION});
+                    advance();
+                }
+                break;
+            case Step::EXPRESSION_REDUCE:
+            case Step::MUL_DIV_REDUCE:
+            {
+                auto right = pop<ExpressionNode>(m_values);
+                auto left = pop<ExpressionNode>(m_values);
+                m_values.push_back(makeMathExpression(frame.op, std::move(left), std::move(right)));
+                m_frames.push_back({frame.step == Step::EXPRESSION_REDUCE ? Step::EXPRESSION_OPERATOR : Step::MUL_DIV_OPERATOR});
+                break;
+            }
+
+            // MulDivExpression ::= PrimaryExpression (('*' | '/') PrimaryExpression)*
+            case Step::MUL_DIV_EXPRESSION:
+                m_frames.push_back({Step::MUL_DIV_OPERATOR});
+                m_frames.push_back({Step::PRIMARY_EXPRESSION});
+                break;
+            case Step::MUL_DIV_OPERATOR:
+                if (type == TokenType::WILDCARD || type == TokenType::SLASH)
+                {
+                    m_frames.push_back({Step::MUL_DIV_REDUCE, m_current_token.getType()});
+                    m_frames.push_back({Step::PRIMARY_EXPRESSION});
+                    advance();
+                }
+                break;
+
+            // PrimaryExpression ::= '(' Expression ')' | IDENTIFIER | NUMBER
+            case Step::PRIMARY_EXPRESSION:
+                if (type == TokenType::LPAREN)
+                {
+                    advance();
+                    m_frames.push_back({Step::PRIMARY_EXPRESSION_END});
+                    m_frames.push_back({Step::EXPRESSION});
+                }
+                else if (type == TokenType::IDENTIFIER || type == TokenType::NUMBER)
+                {
+                    m_values.push_back(makeTerminalExpression(m_current_token));
+                    advance();
+                }
+                else
+                    error("The EXPRESSION is malformed: expected IDENTIFIER/NUMBER, got " + m_current_token.getTokenTypeString());
+                break;
+            case Step::PRIMARY_EXPRESSION_END:
+                consume(TokenType::RPAREN, "Expected RPAREN");
+                break;
+
+            // Predicate ::= AndPredicate ('or' AndPredicate)*
+            case Step::PREDICATE:
+                m_frames.push_back({Step::OR_OPERATOR});
+                m_frames.push_back({Step::AND_PREDICATE});
+                break;
+            case Step::OR_OPERATOR:
+                if (type == TokenType::OR)
+                {
+                    m_frames.push_back({Step::OR_REDUCE, m_current_token.getType()});
+                    m_frames.push_back({Step::AND_PREDICATE});
+                    advance();
+                }
+                break;
+            case Step::OR_REDUCE:
+            case Step::AND_REDUCE:
+            {
+                auto right = pop<PredicateNode>(m_values);
+                auto left = pop<PredicateNode>(m_values);
+                m_values.push_back(makeBooleanPredicate(frame.op, std::move(left), std::move(right)));
+                m_frames.push_back({frame.step == Step::OR_REDUCE ? Step::OR_OPERATOR : Step::AND_OPERATOR});
+                break;
+            }
+
+            // AndPredicate ::= UnaryPredicate ('and' UnaryPredicate)*
+            case Step::AND_PREDICATE:
+                m_frames.push_back({Step::AND_OPERATOR});
+                m_frames.push_back({Step::UNARY_PREDICATE});
+                break;
+            case Step::AND_OPERATOR:
+                if (type == TokenType::AND)
+                {
+                    m_frames.push_back({Step::AND_REDUCE, m_current_token.getType()});
+                    m_frames.push_back({Step::UNARY_PREDICATE});
+                    advance();
+                }
+                break;
+
+            // UnaryPredicate ::= 'not' UnaryPredicate | 'true' | 'false' | '(' Predicate ')' | RelationalPredicate
+            case Step::UNARY_PREDICATE:
+                if (type == TokenType::NOT)
+                {
+                    advance();
+                    m_frames.push_back({Step::NOT_REDUCE});
+                    m_frames.push_back({Step::UNARY_PREDICATE});
+                }
+                else if (type == TokenType::TRUE || type == TokenType::FALSE)
+                {
+                    m_values.push_back(makePredicate(m_current_token.getType()));
+                    advance();
+                }
+                else if (type == TokenType::LPAREN)
+                {
+                    advance();
+                    m_frames.push_back({Step::PRIMARY_PREDICATE_END});
+                    m_frames.push_back({Step::PREDICATE});
+                }
+                else
+                {
+                    m_frames.push_back({Step::RELATIONAL_OPERATOR});
+                    m_frames.push_back({Step::EXPRESSION});
+                }
+                break;
+            case Step::NOT_REDUCE:
+                m_values.push_back(makeNotPredicate(pop<PredicateNode>(m_values)));
+                break;
+            case Step::PRIMARY_PREDICATE_END:
+                consume(TokenType::RPAREN, "Expected ')' after boolean expression");
+                break;
+
+            // RelationalPredicate ::= Expression ('>=' | '>' | '=' | '<' | '<=') Expression
+            case Step::RELATIONAL_OPERATOR:
+                if (type == TokenType::GTE || type == TokenType::GT || type == TokenType::EQ ||
+                    type == TokenType::LT || type == TokenType::LTE)
+                {
+                    m_frames.push_back({Step::RELATIONAL_REDUCE, m_current_token.getType()});
+                    m_frames.push_back({Step::EXPRESSION});
+                    advance();
+                    break;
+                }
+                error("Expected relational operator after expression, got: " + std::string(m_current_token.getValue()));
+                break;
+            case Step::RELATIONAL_REDUCE:
+            {
+                auto right = pop<ExpressionNode>(m_values);
+                auto left = pop<ExpressionNode>(m_values);
+                m_values.push_back(makeRelationalPredicate(frame.op, std::move(left), std::move(right)));
+                break;
+            }
+            }
+
+            if (m_panic)
+                recoverSteps();
+        }
+    }
+
+    void Parser::recoverSteps()
+    {
+        // the steps of the statement that failed are dropped, with the nodes it built
+        while (m_frames.back().step != Step::STATEMENT_END)
+            m_frames.pop_back();
+        m_frames.pop_back();
+
+        StatementMark mark = m_statements.back();
+        m_statements.pop_back();
+        m_values.resize(mark.values);
+
+        // a statement with an error is left out of the tree
+        m_values.push_back(nullptr);
+        recover(mark.open_blocks);
+    }
+
+    template <typename T, typename Matches, typename Make>
+    std::unique_ptr<T> Parser::intern(std::uint64_t hash, NodeKind kind, Matches matches, Make make)
+    {
+        // the children are shared too, so a match only needs to compare them by address
+        ASTNode *shared = m_subtrees.find(hash, [&](const ASTNode &node)
+                                          { return node.getKind() == kind && matches(static_cast<const T &>(node)); });
+        if (shared)
+            return std::unique_ptr<T>(static_cast<T *>(shared));
+
+        std::unique_ptr<T> node = make();
+        m_subtrees.insert(node.get());
+        return node;
+    }
+
+    std::unique_ptr<ExpressionNode> Parser::makeTerminalExpression(const Token &terminal)
+    {
+        // the lexer already converted the digits of a number
+        if (terminal.getType() == TokenType::NUMBER)
+        {
+            std::int64_t value = terminal.getNumber();
+            std::string_view digits = terminal.getValue();
+            if (!m_hash_consing)
+                return std::make_unique<NumberLiteralNode>(value, digits);
+
+            return intern<NumberLiteralNode>(
+                NumberLiteralNode::hashOf(value, digits), NodeKind::NUMBER_LITERAL,
+                [&](const NumberLiteralNode &node)
+                { return node.getValue() == value && (value != NUMBER_OVERFLOW || node.getDigits() == digits); },
+                [&]
+                { return std::make_unique<NumberLiteralNode>(value, digits); });
+        }
+
+        // the identifiers of a program are compared by slot
+        std::uint32_t slot = m_symbols->intern(terminal.getValue());
+        std::string_view name = m_symbols->getName(slot);
+        if (!m_hash_consing)
+            return std::make_unique<VariableRefNode>(slot, name);
+
+        return intern<VariableRefNode>(
+            VariableRefNode::hashOf(name), NodeKind::VARIABLE_REF,
+            [&](const VariableRefNode &node)
+            { return node.getSlot() == slot; },
+            [&]
+            { return std::make_unique<VariableRefNode>(slot, name); });
+    }
+
+    std::unique_ptr<ExpressionNode> Parser::makeMathExpression(TokenType op, std::unique_ptr<ExpressionNode> left, std::unique_ptr<ExpressionNode> right)
+    {
+        if (!m_hash_consing)
+            return std::make_unique<MathExpressionNode>(op, std::move(left), std::move(right));
+
+        return intern<MathExpressionNode>(
+            MathExpressionNode::hashOf(op, left.get(), right.get()), NodeKind::MATH_EXPRESSION,
+            [&](const MathExpressionNode &node)
+            { return node.getOpcode() == op && node.getLeftExpression() == left.get() && node.getRightExpression() == right.get(); },
+            [&]
+            { return std::make_unique<MathExpressionNode>(op, std::move(left), std::move(right)); });
+    }
+
+    std::unique_ptr<PredicateNode> Parser::makePredicate(TokenType constant)
+    {
+        if (!m_hash_consing)
+            return std::make_unique<PredicateNode>(constant);
+
+        return intern<PredicateNode>(
+            PredicateNode::hashOf(constant), NodeKind::PREDICATE,
+            [&](const PredicateNode &node)
+            { return node.getConstant() == constant; },
+            [&]
+            { return std::make_unique<PredicateNode>(constant); });
+    }
+
+    std::unique_ptr<PredicateNode> Parser::makeNotPredicate(std::unique_ptr<PredicateNode> predicate)
+    {
+        if (!m_hash_consing)
+            return std::make_unique<NotPredicateNode>(std::move(predicate));
+
+        return intern<NotPredicateNode>(
+            NotPredicateNode::hashOf(predicate.get()), NodeKind::NOT_PREDICATE,
+            [&](const NotPredicateNode &node)
+            { return node.getPredicate() == predicate.get(); },
+            [&]
+            { return std::make_unique<NotPredicateNode>(std::move(predicate)); });
+    }
+
+    std::unique_ptr<PredicateNode> Parser::makeBooleanPredicate(TokenType op, std::unique_ptr<PredicateNode> left, std::unique_ptr<PredicateNode> right)
+    {
+        if (!m_hash_consing)
+            return std::make_unique<BooleanPredicateNode>(op, std::move(left), std::move(right));
+
+        return intern<BooleanPredicateNode>(
+            BooleanPredicateNode::hashOf(op, left.get(), right.get()), NodeKind::BOOLEAN_PREDICATE,
+            [&](const BooleanPredicateNode &node)
+            { return node.getOpcode() == op && node.getLeftPredicate() == left.get() && node.getRightPredicate() == right.get(); },
+            [&]
+            { return std::make_unique<BooleanPredicateNode>(op, std::move(left), std::move(right)); });
+    }
+
+    std::unique_ptr<RelationalPredicateNode> Parser::makeRelationalPredicate(TokenType op, std::unique_ptr<ExpressionNode> left,
+                                                                             std::unique_ptr<ExpressionNode> right)
+    {
+        if (!m_hash_consing)
+            return std::make_unique<RelationalPredicateNode>(op, std::move(left), std::move(right));
+
+        return intern<RelationalPredicateNode>(
+            RelationalPredicateNode::hashOf(op, left.get(), right.get()), NodeKind::RELATIONAL_PREDICATE,
+            [&](const RelationalPredicateNode &node)
+            { return node.getOpcode() == op && node.getLeftExpression() == left.get() && node.getRightExpression() == right.get(); },
+            [&]
+            { return std::make_unique<RelationalPredicateNode>(op, std::move(left), std::move(right)); });
+    }
+
     void Parser::advance()
     {
+        nextToken();
+        skipUnknownTokens();
+    }
+
+    void Parser::nextToken()
+    {
+        if (m_tokens)
+        {
+            // the last token of the stream is END_OF_FILE, it's never moved past
+            std::size_t last = m_tokens->size() - 1;
+            while (m_next_token < last && m_tokens->getType(m_next_token) == TokenType::END_OF_LINE)
+                ++m_next_token;
+
+            m_current_token = m_tokens->getToken(m_next_token);
+            if (m_next_token < last)
+                ++m_next_token;
+            return;
+        }
 
+        m_previous_end = m_current_token.getOffset() + m_current_token.getValue().size();
         auto token = m_lexer.nextToken();
 
         // skip endlines
         while (token.getType() == TokenType::END_OF_LINE)
             token = m_lexer.nextToken();
 
-        if (token.getType() == TokenType::UNKNOWN)
-            throw std::invalid_argument("The following token is unknown: " + token.getValue());
-
         m_current_token = token;
     }
 
-    Token Parser::consume(TokenType expected, const std::string &errorMessage)
+    void Parser::skipUnknownTokens()
+    {
+        // when collecting diagnostics an unknown token is reported and the parser goes on without it
+        while (m_current_token.getType() == TokenType::UNKNOWN)
+        {
+            report("The following token is unknown: " + std::string(m_current_token.getValue()));
+            nextToken();
+        }
+    }
+
+    void Parser::seek(std::size_t offset)
+    {
+        m_lexer.seek(offset);
+        nextToken();
+        m_previous_end = offset;
+        skipUnknownTokens();
+    }
+
+    void Parser::reset(const std::shared_ptr<const SourceBuffer> &source)
+    {
+        m_lexer.reset(source);
+        m_tokens = nullptr;
+        restart();
+    }
+
+    void Parser::reset(std::unique_ptr<std::istream> raw_code)
+    {
+        m_lexer.reset(std::move(raw_code));
+        m_tokens = nullptr;
+        restart();
+    }
+
+    void Parser::reset(const TokenStream &tokens)
+    {
+        // the lexer is not used, it only keeps the source alive as in the constructor
+        m_lexer.reset(tokens.getSource());
+        m_tokens = &tokens;
+        restart();
+    }
+
+    void Parser::reset(std::string_view text)
+    {
+        m_lexer.reset(text);
+        m_tokens = nullptr;
+        restart();
+    }
+
+    void Parser::restart()
+    {
+        // a parse that threw can leave nodes on the explicit stack and the parser in panic mode
+        m_frames.clear();
+        m_values.clear();
+        m_statements.clear();
+        m_subtrees.clear();
+
+        // the symbol table is reused if no tree of the last program holds it any more
+        if (m_symbols.use_count() == 1)
+        {
+            // a tree destroyed on another thread may have read the names just before releasing the table
+            std::atomic_thread_fence(std::memory_order_acquire);
+            m_symbols->clear();
+        }
+        else
+            m_symbols = std::make_shared<SymbolTable>();
+        m_diagnostics = nullptr;
+        m_panic = false;
+        m_open_blocks = 0;
+        m_incremental = nullptr;
+
+        m_next_token = 0;
+        m_current_token = Token(TokenType::END_OF_FILE, "EOF");
+        m_previous_end = 0;
+        nextToken();
+    }
+
+    bool Parser::consume(TokenType expected, const char *errorMessage)
     {
         if (m_current_token.getType() != expected)
-            throw std::invalid_argument(errorMessage + " Got: " + m_current_token.getTokenTypeString());
+        {
+            error(std::string(errorMessage) + " Got: " + m_current_token.getTokenTypeString());
+            return false;
+        }
 
-        auto token = m_current_token;
         advance();
-        return token;
+        return true;
+    }
+
+    void Parser::report(std::string message)
+    {
+        if (!m_diagnostics)
+            throw std::invalid_argument(message);
+        m_diagnostics->push_back({std::move(message), m_current_token.getOffset()});
+    }
+
+    void Parser::error(std::string message)
+    {
+        report(std::move(message));
+        m_panic = true;
+    }
+
+    void Parser::recover(std::size_t open_blocks)
+    {
+        // the if/while that the statement opened are skipped up to their endif/endwhile
+        std::size_t depth = m_open_blocks - open_blocks;
+        m_open_blocks = open_blocks;
+        m_panic = false;
+
+        while (true)
+        {
+            TokenType type = m_current_token.getType();
+            if (type == TokenType::END_OF_FILE)
+                return;
+
+            if (type == TokenType::IF || type == TokenType::WHILE)
+                ++depth;
+            else if (type == TokenType::ENDIF || type == TokenType::ENDWHILE)
+            {
+                // the end of the block around the statement is left to it
+                if (depth == 0 && open_blocks > 0)
+                    return;
+                advance();
+                if (depth == 0 || --depth == 0)
+                    return;
+                continue;
+            }
+            else if (depth == 0 && type == TokenType::ELSE && open_blocks > 0)
+                return;
+            else if (depth == 0 && type == TokenType::SEMICOLON)
+            {
+                advance();
+                return;
+            }
+            advance();
+        }
     }
 }
@@ -0,0 +1,45 @@
+#include "../include/ParserPool.hpp"
+
+#include <sstream>
+
+namespace WhileParser
+{
+    void ParserPool::Release::operator()(Parser *parser) const
+    {
+        pool->release(parser);
+    }
+
+    ParserPool::Lease ParserPool::acquire()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (!m_idle.empty())
+            {
+                Parser *parser = m_idle.back().release();
+                m_idle.pop_back();
+                return Lease(parser, Release{this});
+            }
+        }
+
+        auto parser = std::make_unique<Parser>(std::make_unique<std::istringstream>());
+        parser->setParseMode(m_mode);
+        parser->reset(std::string_view());
+        return Lease(parser.release(), Release{this});
+    }
+
+    std::size_t ParserPool::idle()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_idle.size();
+    }
+
+    void ParserPool::release(Parser *parser)
+    {
+        // the parser doesn't keep the last program alive while it waits
+        std::unique_ptr<Parser> owned(parser);
+        owned->reset(std::string_view());
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_idle.push_back(std::move(owned));
+    }
+}
@@ -0,0 +1,271 @@
+#include "../include/Scanner.hpp"
+
+#include <bit>
+#include <cstring>
+#include <limits>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define WHILE_PARSER_X86 1
+#include <immintrin.h>
+#endif
+
+namespace WhileParser
+{
+    namespace
+    {
+        inline const char *scanClass(const char *begin, const char *end, std::uint8_t char_class)
+        {
+            while (begin != end && hasCharClass(*begin, char_class))
+                ++begin;
+            return begin;
+        }
+
+        const char *scanIdentifierScalar(const char *begin, const char *end)
+        {
+            return scanClass(begin, end, CHAR_IDENTIFIER);
+        }
+
+        const char *scanDigitsScalar(const char *begin, const char *end)
+        {
+            return scanClass(begin, end, CHAR_DIGIT);
+        }
+
+        const char *scanBlanksScalar(const char *begin, const char *end, bool spaces, bool newlines)
+        {
+            std::uint8_t char_class = (spaces ? CHAR_SPACE : 0) | (newlines ? CHAR_NEWLINE : 0);
+            return scanClass(begin, end, char_class);
+        }
+
+#ifdef WHILE_PARSER_X86
+        // Characters are compared as signed bytes: everything >= 0x80 is negative
+        // and never falls in one of the ASCII ranges of the language.
+
+        inline __m128i inRange(__m128i chars, char low, char high)
+        {
+            return _mm_and_si128(_mm_cmpgt_epi8(chars, _mm_set1_epi8(low - 1)),
+                                 _mm_cmpgt_epi8(_mm_set1_epi8(high + 1), chars));
+        }
+
+        inline __m128i identifierMask(__m128i chars)
+        {
+            // setting bit 5 maps A-Z onto a-z, and nothing else onto a-z
+            __m128i lower = _mm_or_si128(chars, _mm_set1_epi8(0x20));
+            return _mm_or_si128(_mm_or_si128(inRange(lower, 'a', 'z'), inRange(chars, '0', '9')),
+                                _mm_cmpeq_epi8(chars, _mm_set1_epi8('_')));
+        }
+
+        inline __m128i blanksMask(__m128i chars, __m128i spaces, __m128i newlines)
+        {
+            return _mm_or_si128(_mm_and_si128(_mm_cmpeq_epi8(chars, _mm_set1_epi8(' ')), spaces),
+                                _mm_and_si128(_mm_cmpeq_epi8(chars, _mm_set1_epi8('\n')), newlines));
+        }
+
+        // offset of the first character outside the run, 16 if the whole block matched
+        inline unsigned firstMismatch(__m128i mask)
+        {
+            unsigned mismatches = ~static_cast<unsigned>(_mm_movemask_epi8(mask)) & 0xFFFFu;
+            return mismatches ? __builtin_ctz(mismatches) : 16;
+        }
+
+        const char *scanIdentifierSse2(const char *begin, const char *end)
+        {
+            while (end - begin >= 16)
+            {
+                unsigned run = firstMismatch(identifierMask(_mm_loadu_si128(reinterpret_cast<const __m128i *>(begin))));
+                begin += run;
+                if (run != 16)
+                    return begin;
+            }
+            return scanIdentifierScalar(begin, end);
+        }
+
+        const char *scanDigitsSse2(const char *begin, const char *end)
+        {
+            while (end - begin >= 16)
+            {
+                unsigned run = firstMismatch(inRange(_mm_loadu_si128(reinterpret_cast<const __m128i *>(begin)), '0', '9'));
+                begin += run;
+                if (run != 16)
+                    return begin;
+            }
+            return scanDigitsScalar(begin, end);
+        }
+
+        const char *scanBlanksSse2(const char *begin, const char *end, bool spaces, bool newlines)
+        {
+            __m128i spaces_enabled = _mm_set1_epi8(spaces ? -1 : 0);
+            __m128i newlines_enabled = _mm_set1_epi8(newlines ? -1 : 0);
+            while (end - begin >= 16)
+            {
+                __m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i *>(begin));
+                unsigned run = firstMismatch(blanksMask(chars, spaces_enabled, newlines_enabled));
+                begin += run;
+                if (run != 16)
+                    return begin;
+            }
+            return scanBlanksScalar(begin, end, spaces, newlines);
+        }
+
+#define WHILE_PARSER_AVX2 __attribute__((target("avx2")))
+
+        WHILE_PARSER_AVX2 inline __m256i inRange256(__m256i chars, char low, char high)
+        {
+            return _mm256_and_si256(_mm256_cmpgt_epi8(chars, _mm256_set1_epi8(low - 1)),
+                                    _mm256_cmpgt_epi8(_mm256_set1_epi8(high + 1), chars));
+        }
+
+        WHILE_PARSER_AVX2 inline __m256i identifierMask256(__m256i chars)
+        {
+            __m256i lower = _mm256_or_si256(chars, _mm256_set1_epi8(0x20));
+            return _mm256_or_si256(_mm256_or_si256(inRange256(lower, 'a', 'z'), inRange256(chars, '0', '9')),
+                                   _mm256_cmpeq_epi8(chars, _mm256_set1_epi8('_')));
+        }
+
+        WHILE_PARSER_AVX2 inline unsigned firstMismatch256(__m256i mask)
+        {
+            unsigned mismatches = ~static_cast<unsigned>(_mm256_movemask_epi8(mask));
+            return mismatches ? __builtin_ctz(mismatches) : 32;
+        }
+
+        // The AVX2 kernels end with the SSE2 ones, that are not VEX encoded: the upper halves of the
+        // registers are cleared first, or every SSE instruction after them pays for the transition
+        WHILE_PARSER_AVX2 const char *scanIdentifierAvx2(const char *begin, const char *end)
+        {
+            while (end - begin >= 32)
+            {
+                unsigned run = firstMismatch256(identifierMask256(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(begin))));
+                begin += run;
+                if (run != 32)
+                    return begin;
+            }
+            _mm256_zeroupper();
+            return scanIdentifierSse2(begin, end);
+        }
+
+        WHILE_PARSER_AVX2 const char *scanDigitsAvx2(const char *begin, const char *end)
+        {
+            while (end - begin >= 32)
+            {
+                unsigned run = firstMismatch256(inRange256(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(begin)), '0', '9'));
+                begin += run;
+                if (run != 32)
+                    return begin;
+            }
+            _mm256_zeroupper();
+            return scanDigitsSse2(begin, end);
+        }
+
+        WHILE_PARSER_AVX2 const char *scanBlanksAvx2(const char *begin, const char *end, bool spaces, bool newlines)
+        {
+            __m256i spaces_enabled = _mm256_set1_epi8(spaces ? -1 : 0);
+            __m256i newlines_enabled = _mm256_set1_epi8(newlines ? -1 : 0);
+            while (end - begin >= 32)
+            {
+                __m256i chars = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(begin));
+                __m256i mask = _mm256_or_si256(_mm256_and_si256(_mm256_cmpeq_epi8(chars, _mm256_set1_epi8(' ')), spaces_enabled),
+                                               _mm256_and_si256(_mm256_cmpeq_epi8(chars, _mm256_set1_epi8('\n')), newlines_enabled));
+                unsigned run = firstMismatch256(mask);
+                begin += run;
+                if (run != 32)
+                    return begin;
+            }
+            _mm256_zeroupper();
+            return scanBlanksSse2(begin, end, spaces, newlines);
+        }
+#endif
+
+        // from the fastest to the scalar one: a CPU that runs one runs all the ones after it
+        constexpr ScanKernels KERNELS[] = {
+#ifdef WHILE_PARSER_X86
+            {"avx2", scanIdentifierAvx2, scanDigitsAvx2, scanBlanksAvx2},
+            {"sse2", scanIdentifierSse2, scanDigitsSse2, scanBlanksSse2},
+#endif
+            {"scalar", scanIdentifierScalar, scanDigitsScalar, scanBlanksScalar}};
+
+        // index in KERNELS of the fastest one the CPU runs
+        std::size_t selectKernels()
+        {
+#ifdef WHILE_PARSER_X86
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx2") ? 0 : 1;
+#else
+            return 0;
+#endif
+        }
+
+        // picked on first use, so a scan run by a static initializer of another file gets them too
+        inline std::size_t selectedKernels()
+        {
+            static const std::size_t selected = selectKernels();
+            return selected;
+        }
+
+        inline const ScanKernels &kernels()
+        {
+            return KERNELS[selectedKernels()];
+        }
+
+        // the 8 digits of a little endian word: pairs, then quads, then the whole word
+        inline std::uint64_t parseEightDigits(std::uint64_t word)
+        {
+            constexpr std::uint64_t MASK = 0x000000FF000000FFull;
+            constexpr std::uint64_t MUL_HIGH = 100 + (1000000ull << 32);
+            constexpr std::uint64_t MUL_LOW = 1 + (10000ull << 32);
+
+            word -= 0x3030303030303030ull;
+            word = word * 10 + (word >> 8);
+            return (((word & MASK) * MUL_HIGH) + (((word >> 16) & MASK) * MUL_LOW)) >> 32;
+        }
+    }
+
+    const char *scanIdentifier(const char *begin, const char *end)
+    {
+        return kernels().identifier(begin, end);
+    }
+
+    const char *scanDigits(const char *begin, const char *end)
+    {
+        return kernels().digits(begin, end);
+    }
+
+    const char *scanBlanks(const char *begin, const char *end, bool spaces, bool newlines)
+    {
+        return kernels().blanks(begin, end, spaces, newlines);
+    }
+
+    const char *scannerImplementation()
+    {
+        return kernels().name;
+    }
+
+    std::span<const ScanKernels> supportedScanKernels()
+    {
+        return std::span<const ScanKernels>(KERNELS).subspan(selectedKernels());
+    }
+
+    std::int64_t parseNumber(const char *begin, const char *end)
+    {
+        // the leading zeros don't count: up to 19 significant digits always fit in the unsigned word
+        while (begin != end && *begin == '0')
+            ++begin;
+        if (end - begin > 19)
+            return NUMBER_OVERFLOW;
+
+        std::uint64_t value = 0;
+        if constexpr (std::endian::native == std::endian::little)
+        {
+            for (; end - begin >= 8; begin += 8)
+            {
+                std::uint64_t word;
+                std::memcpy(&word, begin, 8);
+                value = value * 100000000 + parseEightDigits(word);
+            }
+        }
+        for (; begin != end; ++begin)
+            value = value * 10 + static_cast<std::uint64_t>(*begin - '0');
+
+        if (value > static_cast<std::uint64_t>(std::numeric_limits<std::int64_t>::max()))
+            return NUMBER_OVERFLOW;
+        return static_cast<std::int64_t>(value);
+    }
+}
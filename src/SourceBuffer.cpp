@@ -0,0 +1,77 @@
+#include "../include/SourceBuffer.hpp"
+
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace WhileParser
+{
+    std::unique_ptr<SourceBuffer> SourceBuffer::map(const std::string &filename)
+    {
+        // only a regular file can be mapped: a pipe or a device has no size and is read as a stream.
+        // It's checked before opening it, that for a pipe waits for the writer
+        struct stat info;
+        if (::stat(filename.c_str(), &info) == 0 && !S_ISREG(info.st_mode))
+        {
+            std::ifstream stream(filename, std::ios::binary);
+            if (!stream.is_open())
+                throw std::runtime_error("Impossible to open the file");
+            return fromStream(stream);
+        }
+
+        int fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd < 0)
+            throw std::runtime_error("Impossible to open the file");
+
+        if (::fstat(fd, &info) != 0)
+        {
+            ::close(fd);
+            throw std::runtime_error("Impossible to read the size of the file");
+        }
+
+        std::size_t size = static_cast<std::size_t>(info.st_size);
+
+        // an empty file cannot be mapped, but it is still a valid (empty) program
+        if (size == 0)
+        {
+            ::close(fd);
+            return std::unique_ptr<SourceBuffer>(new SourceBuffer(nullptr, 0, false));
+        }
+
+        void *data = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        // the mapping keeps its own reference to the file
+        ::close(fd);
+
+        if (data == MAP_FAILED)
+            throw std::runtime_error("Impossible to map the file");
+
+        ::madvise(data, size, MADV_SEQUENTIAL);
+
+        return std::unique_ptr<SourceBuffer>(new SourceBuffer(static_cast<const char *>(data), size, true));
+    }
+
+    std::unique_ptr<SourceBuffer> SourceBuffer::fromString(std::string text)
+    {
+        auto buffer = std::unique_ptr<SourceBuffer>(new SourceBuffer(nullptr, 0, false));
+        buffer->m_owned = std::move(text);
+        buffer->m_data = buffer->m_owned.data();
+        buffer->m_size = buffer->m_owned.size();
+        return buffer;
+    }
+
+    std::unique_ptr<SourceBuffer> SourceBuffer::fromStream(std::istream &stream)
+    {
+        return fromString(std::string(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>()));
+    }
+
+    SourceBuffer::~SourceBuffer()
+    {
+        if (m_mapped)
+            ::munmap(const_cast<char *>(m_data), m_size);
+    }
+}
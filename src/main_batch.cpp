@@ -0,0 +1,81 @@
+#include "../include/BatchParser.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Validates many .wh files: batch [-j threads] [-q] [-c cache directory] <directory | file.wh | file list>...
+// Prints a line per file (only the failed ones with -q) and the totals; the exit code is 1 if a file failed
+int main(int argc, char **argv)
+{
+    unsigned threads = 0;
+    bool quiet = false;
+    std::unique_ptr<WhileParser::ParseCache> cache;
+    std::vector<std::string> paths;
+
+    try
+    {
+        for (int idx = 1; idx < argc; ++idx)
+        {
+            if (std::strcmp(argv[idx], "-j") == 0 && idx + 1 < argc)
+                threads = static_cast<unsigned>(std::stoul(argv[++idx]));
+            else if (std::strcmp(argv[idx], "-q") == 0)
+                quiet = true;
+            else if (std::strcmp(argv[idx], "-c") == 0 && idx + 1 < argc)
+                cache = std::make_unique<WhileParser::ParseCache>(argv[++idx]);
+            else
+                for (auto &file : WhileParser::BatchParser::collectFiles(argv[idx]))
+                    paths.push_back(std::move(file));
+        }
+    }
+    catch (const std::exception &exception)
+    {
+        std::cerr << exception.what() << std::endl;
+        return 2;
+    }
+
+    if (paths.empty())
+    {
+        std::cerr << "Usage: batch [-j threads] [-q] [-c cache directory] <directory | file.wh | file list>..." << std::endl;
+        return 2;
+    }
+
+    WhileParser::BatchParser batch(threads);
+    batch.setCache(cache.get());
+    auto start = std::chrono::steady_clock::now();
+    auto results = batch.parseFiles(paths);
+    double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    std::size_t failed = 0;
+    std::size_t bytes = 0;
+    for (const auto &result : results)
+    {
+        bytes += result.bytes;
+        if (!result.ok)
+            ++failed;
+        if (quiet && result.ok)
+            continue;
+
+        std::printf("%s %10.3f ms %10zu B  %s", result.ok ? "PASS" : "FAIL", result.milliseconds, result.bytes, result.path.c_str());
+        if (!result.ok)
+            std::printf(": %s", result.message.c_str());
+        if (result.errors > 1)
+            std::printf(" (%zu errors)", result.errors);
+        if (result.cached)
+            std::printf(" (cached)");
+        std::printf("\n");
+    }
+
+    double megabytes = static_cast<double>(bytes) / (1024.0 * 1024.0);
+    std::printf("%zu files, %zu passed, %zu failed, %.2f MiB in %.1f ms (%.1f MiB/s, %u threads)\n",
+                results.size(), results.size() - failed, failed, megabytes, elapsed,
+                elapsed > 0 ? megabytes * 1000.0 / elapsed : 0.0, batch.getThreads());
+    if (cache)
+        std::printf("cache: %zu hits, %zu misses\n", cache->getHits(), cache->getMisses());
+
+    return failed == 0 ? 0 : 1;
+}
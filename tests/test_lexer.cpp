@@ -1,9 +1,67 @@
 #include <gtest/gtest.h>
+#include <atomic>
 #include <sstream>
 #include <memory>
 #include <vector>
+#include <fstream>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <new>
+#include <thread>
+
+#include <sys/stat.h>
 
 #include "../include/Lexer.hpp"
+#include "../include/DfaLexer.hpp"
+#include "../include/ParallelLexer.hpp"
+
+// Counts every heap allocation of the test binary, to measure allocations per token.
+// Atomic, since the parallel lexer allocates on several threads
+static std::atomic<std::size_t> g_allocations = 0;
+
+void *operator new(std::size_t size)
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *memory = std::malloc(size ? size : 1))
+        return memory;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void *memory, std::size_t) noexcept
+{
+    std::free(memory);
+}
+
+// Helper to build a long program with every kind of token
+std::string repeatedProgram(int statements)
+{
+    std::string code;
+    for (int i = 0; i < statements; ++i)
+        code += "counter_variable := (counter_variable + 12345) * 2;\nif x <= 10 and not y >= 3 then skip else z := 1 endif\n";
+    return code;
+}
+
+// Helper to lex a whole program copying every token, returns the allocations per token
+double allocationsPerToken(WhileParser::Lexer &lex)
+{
+    std::size_t tokens = 0;
+    std::size_t before = g_allocations;
+
+    while (lex.isTokenAvailable())
+    {
+        WhileParser::Token t = lex.nextToken();
+        WhileParser::Token copy = t;
+        tokens += copy.getValue().empty() ? 0 : 1;
+    }
+
+    return static_cast<double>(g_allocations - before) / tokens;
+}
 
 // Helper to tokenize a comparison string
 std::vector<WhileParser::TokenType> tokenizeString(const std::string &input)
@@ -242,4 +300,390 @@ TEST(LexerTest, StandardWhitespaces)
 
     EXPECT_EQ(t.getType(), WhileParser::TokenType::NUMBER);
     EXPECT_EQ(lex.nextToken().getType(), WhileParser::TokenType::SEMICOLON);
-}
\ No newline at end of file
+}
+
+// 12. Test Memory Mapped Source
+TEST(LexerTest, MappedFileMatchesStream)
+{
+    const std::string code = "x := 10;\nwhile x >= 1 do\n  x := x - 1;\nendwhile\nif_var:=123abc";
+    const std::string filename = ::testing::TempDir() + "lexer_mapped.wh";
+    {
+        std::ofstream file(filename);
+        file << code;
+    }
+
+    WhileParser::Lexer mapped(filename, false, false);
+    WhileParser::Lexer streamed(std::make_unique<std::istringstream>(code), false, false);
+
+    while (streamed.isTokenAvailable())
+    {
+        auto expected = streamed.nextToken();
+        auto t = mapped.nextToken();
+        EXPECT_EQ(t.getType(), expected.getType());
+        EXPECT_EQ(t.getValue(), expected.getValue());
+    }
+    EXPECT_FALSE(mapped.isTokenAvailable());
+
+    std::remove(filename.c_str());
+}
+
+// 13. Test Empty Mapped Source
+TEST(LexerTest, EmptyMappedFile)
+{
+    const std::string filename = ::testing::TempDir() + "lexer_empty.wh";
+    std::ofstream(filename).close();
+
+    WhileParser::Lexer mapped(filename, true, true);
+    EXPECT_EQ(mapped.nextToken().getType(), WhileParser::TokenType::END_OF_FILE);
+
+    std::remove(filename.c_str());
+}
+
+
+// 14. Test Allocations Per Token
+TEST(LexerTest, MappedTokensDoNotAllocate)
+{
+    const std::string filename = ::testing::TempDir() + "lexer_allocations.wh";
+    {
+        std::ofstream file(filename);
+        file << repeatedProgram(1000);
+    }
+
+    WhileParser::Lexer lex(filename, true, true);
+    EXPECT_EQ(allocationsPerToken(lex), 0.0);
+
+    std::remove(filename.c_str());
+}
+
+TEST(LexerTest, StreamTokensReuseTheChunkBuffer)
+{
+    WhileParser::Lexer lex(std::make_unique<std::istringstream>(repeatedProgram(1000)), true, true);
+
+    // only the chunk buffer is allocated
+    EXPECT_LT(allocationsPerToken(lex), 0.001);
+}
+
+// 15. Test Compile-Time Keyword Recognition
+static_assert(WhileParser::classifyWord("endwhile") == WhileParser::TokenType::ENDWHILE);
+static_assert(WhileParser::classifyWord("endwhil") == WhileParser::TokenType::IDENTIFIER);
+static_assert(WhileParser::classifyWord("Skip") == WhileParser::TokenType::IDENTIFIER);
+
+TEST(LexerTest, EverySpellingRoundTrips)
+{
+    for (int i = 0; i <= static_cast<int>(WhileParser::TokenType::END_OF_LINE); ++i)
+    {
+        auto type = static_cast<WhileParser::TokenType>(i);
+        auto spelling = WhileParser::tokenSpelling(type);
+        if (spelling.empty() || type == WhileParser::TokenType::END_OF_FILE)
+            continue;
+
+        std::size_t length = 0;
+        auto recognized = std::isalpha(static_cast<unsigned char>(spelling[0]))
+                              ? WhileParser::classifyWord(spelling)
+                              : WhileParser::classifySymbol(spelling[0], spelling.size() > 1 ? spelling[1] : '\0', length);
+        EXPECT_EQ(recognized, type) << "Mismatch for " << spelling;
+    }
+}
+
+// 16. Test Scanning Kernels Against The Character Classes
+TEST(LexerTest, ScanningKernelsMatchCharClasses)
+{
+    const std::string alphabet = "aZ_09 \n;:=\t@\xe9";
+    std::string buffer;
+    unsigned seed = 42;
+    for (int i = 0; i < 4096; ++i)
+    {
+        seed = seed * 1103515245 + 12345;
+        // long runs of the same class, to exercise whole blocks
+        buffer.append((seed >> 8) % 70, alphabet[(seed >> 16) % alphabet.size()]);
+    }
+
+    auto reference = [](const char *begin, const char *end, std::uint8_t char_class)
+    {
+        while (begin != end && WhileParser::hasCharClass(*begin, char_class))
+            ++begin;
+        return begin;
+    };
+
+    // every implementation the CPU runs, not only the one in use
+    auto kernels = WhileParser::supportedScanKernels();
+    ASSERT_STREQ(kernels.front().name, WhileParser::scannerImplementation());
+    ASSERT_STREQ(kernels.back().name, "scalar");
+
+    const char *end = buffer.data() + buffer.size();
+    for (const WhileParser::ScanKernels &kernel : kernels)
+    {
+        SCOPED_TRACE(kernel.name);
+        for (const char *begin = buffer.data(); begin != end; ++begin)
+        {
+            ASSERT_EQ(kernel.identifier(begin, end), reference(begin, end, WhileParser::CHAR_IDENTIFIER));
+            ASSERT_EQ(kernel.digits(begin, end), reference(begin, end, WhileParser::CHAR_DIGIT));
+            ASSERT_EQ(kernel.blanks(begin, end, true, true), reference(begin, end, WhileParser::CHAR_SPACE | WhileParser::CHAR_NEWLINE));
+            ASSERT_EQ(kernel.blanks(begin, end, true, false), reference(begin, end, WhileParser::CHAR_SPACE));
+            ASSERT_EQ(kernel.blanks(begin, end, false, true), reference(begin, end, WhileParser::CHAR_NEWLINE));
+        }
+    }
+
+    for (const char *begin = buffer.data(); begin != end; ++begin)
+    {
+        ASSERT_EQ(WhileParser::scanIdentifier(begin, end), reference(begin, end, WhileParser::CHAR_IDENTIFIER));
+        ASSERT_EQ(WhileParser::scanDigits(begin, end), reference(begin, end, WhileParser::CHAR_DIGIT));
+        ASSERT_EQ(WhileParser::scanBlanks(begin, end, true, true), reference(begin, end, WhileParser::CHAR_SPACE | WhileParser::CHAR_NEWLINE));
+        ASSERT_EQ(WhileParser::scanBlanks(begin, end, true, false), reference(begin, end, WhileParser::CHAR_SPACE));
+        ASSERT_EQ(WhileParser::scanBlanks(begin, end, false, true), reference(begin, end, WhileParser::CHAR_NEWLINE));
+    }
+}
+
+// 17. Test Bulk Tokenization
+TEST(LexerTest, TokenizeAllMatchesNextToken)
+{
+    const std::string code = "x := 10;\nwhile x >= 1 do\n  x := x - 1;\nendwhile\nif_var:=123abc @";
+
+    for (bool skip : {true, false})
+    {
+        auto tokens = WhileParser::Lexer(std::make_unique<std::istringstream>(code), skip, skip).tokenizeAll();
+        WhileParser::Lexer lex(std::make_unique<std::istringstream>(code), skip, skip);
+
+        std::size_t idx = 0;
+        while (lex.isTokenAvailable())
+        {
+            auto t = lex.nextToken();
+            ASSERT_LT(idx, tokens.size());
+            EXPECT_EQ(tokens.getType(idx), t.getType());
+            EXPECT_EQ(tokens.getValue(idx), t.getValue());
+            EXPECT_EQ(tokens.getOffset(idx), t.getOffset());
+            ++idx;
+        }
+        EXPECT_EQ(idx, tokens.size());
+        EXPECT_EQ(tokens.getType(tokens.size() - 1), WhileParser::TokenType::END_OF_FILE);
+    }
+
+    // after some nextToken() the offsets are in the text that was left, " 10;..."
+    WhileParser::Lexer started(std::make_unique<std::istringstream>(code), true, true);
+    EXPECT_EQ(started.nextToken().getOffset(), 0u);
+    EXPECT_EQ(started.nextToken().getOffset(), 2u);
+    auto rest = started.tokenizeAll();
+    EXPECT_EQ(rest.getValue(0), "10");
+    EXPECT_EQ(rest.getOffset(0), 1u);
+    EXPECT_EQ(rest.getSource()->text().substr(rest.getOffset(0), 2), "10");
+}
+
+// 18. Differential Test Of The DFA Engine
+void expectSameTokens(const std::string &code, bool skip_whitespaces, bool skip_eol)
+{
+    WhileParser::Lexer lex(std::make_unique<std::istringstream>(code), skip_whitespaces, skip_eol);
+    WhileParser::DfaLexer dfa(WhileParser::SourceBuffer::fromString(code), skip_whitespaces, skip_eol);
+
+    while (lex.isTokenAvailable())
+    {
+        auto expected = lex.nextToken();
+        ASSERT_TRUE(dfa.isTokenAvailable()) << "for " << code;
+        auto t = dfa.nextToken();
+        ASSERT_EQ(t.getType(), expected.getType()) << "at offset " << expected.getOffset() << " of " << code;
+        ASSERT_EQ(t.getValue(), expected.getValue()) << "at offset " << expected.getOffset() << " of " << code;
+        ASSERT_EQ(t.getOffset(), expected.getOffset()) << "for " << code;
+    }
+    EXPECT_FALSE(dfa.isTokenAvailable());
+}
+
+TEST(LexerTest, DfaEngineMatchesLexer)
+{
+    // the inputs of the tests above, plus random soups of the alphabet of the language
+    std::vector<std::string> inputs = {
+        "x := 10;", "while WHILE if IF skip SKIP", "and or not true false < <= = >= >",
+        "(a + b) * c / d - 5", "if true then x := 1; else skip; endif", "@ #",
+        "if_var then123 endif_ xendif", "x:=10+y;while(true)do", "123abc456", "< <= > >= := :",
+        "x  :=  \n  5  ;", "", "   ", "\n\n", ":", "12_3", "x := 1\r\n"};
+
+    const std::string alphabet = "ax_Z09 \n:=<>;+-*/()@\tendifwhiledo";
+    unsigned seed = 7;
+    for (int i = 0; i < 500; ++i)
+    {
+        std::string code;
+        for (int j = 0; j < 40; ++j)
+        {
+            seed = seed * 1103515245 + 12345;
+            code += alphabet[(seed >> 16) % alphabet.size()];
+        }
+        inputs.push_back(code);
+    }
+
+    for (const auto &code : inputs)
+        for (bool skip_whitespaces : {false, true})
+            for (bool skip_eol : {false, true})
+                expectSameTokens(code, skip_whitespaces, skip_eol);
+}
+
+// 19. Test Long Runs Of Skipped Blanks
+TEST(LexerTest, LongBlankRunsDoNotRecurse)
+{
+    const std::string code = std::string(2000000, ' ') + std::string(2000000, '\n') + "x";
+
+    WhileParser::Lexer lex(std::make_unique<std::istringstream>(code), true, true);
+    EXPECT_EQ(lex.nextToken().getType(), WhileParser::TokenType::IDENTIFIER);
+
+    WhileParser::DfaLexer dfa(WhileParser::SourceBuffer::fromString(code), true, true);
+    auto t = dfa.nextToken();
+    EXPECT_EQ(t.getType(), WhileParser::TokenType::IDENTIFIER);
+    EXPECT_EQ(t.getOffset(), 4000000u);
+}
+
+// 20. Test Chunked Streams
+TEST(LexerTest, TokensSpanningChunkBoundaries)
+{
+    const std::string code = "x := 10;\nwhile x >= 1 do\n  x := x - 1;\nendwhile\n" + std::string(100, 'v') + " := 123456789012 :<> 12ab";
+    auto source = WhileParser::SourceBuffer::fromString(code);
+    const std::shared_ptr<const WhileParser::SourceBuffer> shared_source = std::move(source);
+
+    for (std::size_t chunk_size : {1, 2, 3, 7, 64})
+    {
+        for (bool skip : {true, false})
+        {
+            WhileParser::Lexer in_memory(shared_source, skip, skip);
+            WhileParser::Lexer chunked(std::make_unique<std::istringstream>(code), skip, skip, chunk_size);
+
+            while (in_memory.isTokenAvailable())
+            {
+                auto expected = in_memory.nextToken();
+                auto t = chunked.nextToken();
+                ASSERT_EQ(t.getType(), expected.getType()) << "chunk size " << chunk_size;
+                ASSERT_EQ(t.getValue(), expected.getValue()) << "chunk size " << chunk_size;
+                ASSERT_EQ(t.getOffset(), expected.getOffset()) << "chunk size " << chunk_size;
+            }
+            EXPECT_FALSE(chunked.isTokenAvailable());
+        }
+    }
+}
+
+// Stream that produces the same statement over and over, without keeping the input in memory
+class RepeatingStreamBuffer : public std::streambuf
+{
+public:
+    RepeatingStreamBuffer(const std::string &pattern, std::size_t repetitions) : m_pattern(pattern), m_repetitions(repetitions) {}
+
+protected:
+    int_type underflow() override
+    {
+        if (m_repetitions == 0)
+            return traits_type::eof();
+        --m_repetitions;
+        setg(m_pattern.data(), m_pattern.data(), m_pattern.data() + m_pattern.size());
+        return traits_type::to_int_type(m_pattern[0]);
+    }
+
+private:
+    std::string m_pattern;
+    std::size_t m_repetitions;
+};
+
+TEST(LexerTest, StreamMemoryIsBoundedByTheChunk)
+{
+    const std::string statement = "counter := (counter + 12345) * 2;\n";
+    const std::size_t repetitions = 500000;
+    RepeatingStreamBuffer buffer(statement, repetitions);
+
+    WhileParser::Lexer lex(std::make_unique<std::istream>(&buffer), true, true, 4096);
+
+    std::size_t tokens = 0;
+    std::size_t before = g_allocations;
+    while (lex.nextToken().getType() != WhileParser::TokenType::END_OF_FILE)
+        ++tokens;
+
+    EXPECT_EQ(tokens, repetitions * 10);
+    // a single chunk for the whole input
+    EXPECT_LE(g_allocations - before, 1u);
+}
+
+// 21. Test Parallel Lexing
+TEST(LexerTest, ParallelLexingMatchesSequential)
+{
+    // padding makes some of the cuts land inside runs of blanks
+    std::string code = repeatedProgram(6000) + std::string(100000, ' ') + "x:=1;\n\n\n" + repeatedProgram(100) + "12ab @ :";
+    const std::shared_ptr<const WhileParser::SourceBuffer> source = WhileParser::SourceBuffer::fromString(code);
+
+    for (bool skip_whitespaces : {false, true})
+    {
+        for (bool skip_eol : {false, true})
+        {
+            auto expected = WhileParser::Lexer(source, skip_whitespaces, skip_eol).tokenizeAll();
+
+            for (unsigned threads : {1u, 2u, 3u, 8u})
+            {
+                WhileParser::ParallelLexer lexer(source, skip_whitespaces, skip_eol, threads);
+                EXPECT_EQ(lexer.splitPoints().size(), threads + 1);
+
+                auto tokens = lexer.tokenizeAll();
+                ASSERT_EQ(tokens.size(), expected.size()) << threads << " threads";
+
+                std::size_t idx = 0;
+                while (idx < tokens.size() && tokens.getType(idx) == expected.getType(idx) &&
+                       tokens.getOffset(idx) == expected.getOffset(idx) && tokens.getLength(idx) == expected.getLength(idx))
+                    ++idx;
+                EXPECT_EQ(idx, tokens.size()) << "first mismatch with " << threads << " threads";
+            }
+        }
+    }
+}
+
+TEST(LexerTest, ParallelLexingOfSmallSources)
+{
+    const std::shared_ptr<const WhileParser::SourceBuffer> source = WhileParser::SourceBuffer::fromString("x := 1;");
+
+    WhileParser::ParallelLexer lexer(source, true, true, 8);
+    EXPECT_EQ(lexer.splitPoints().size(), 2u);
+    EXPECT_EQ(lexer.tokenizeAll().size(), 5u);
+
+    WhileParser::ParallelLexer empty(WhileParser::SourceBuffer::fromString(""), true, true, 8);
+    auto tokens = empty.tokenizeAll();
+    ASSERT_EQ(tokens.size(), 1u);
+    EXPECT_EQ(tokens.getType(0), WhileParser::TokenType::END_OF_FILE);
+}
+
+TEST(LexerTest, NumbersCarryTheirValue)
+{
+    const std::string code = "x := 0 + 007 + 9223372036854775807 + 9223372036854775808 + 123456789012345678901234";
+    const std::int64_t expected[] = {0, 7, INT64_MAX, WhileParser::NUMBER_OVERFLOW, WhileParser::NUMBER_OVERFLOW};
+    const std::shared_ptr<const WhileParser::SourceBuffer> source = WhileParser::SourceBuffer::fromString(code);
+
+    // the streamed lexer, the DFA and the token stream agree on the values
+    WhileParser::Lexer lexer(std::make_unique<std::istringstream>(code), true, true, 16);
+    WhileParser::DfaLexer dfa(source, true, true);
+    auto tokens = WhileParser::Lexer(source, true, true).tokenizeAll();
+
+    std::size_t count = 0;
+    for (std::size_t idx = 0; idx < tokens.size(); ++idx)
+    {
+        WhileParser::Token streamed = lexer.nextToken();
+        WhileParser::Token scanned = dfa.nextToken();
+        if (streamed.getType() != WhileParser::TokenType::NUMBER)
+            continue;
+        ASSERT_LT(count, 5u);
+        EXPECT_EQ(streamed.getNumber(), expected[count]) << streamed.getValue();
+        EXPECT_EQ(scanned.getNumber(), expected[count]) << scanned.getValue();
+        EXPECT_EQ(tokens.getToken(idx).getNumber(), expected[count]) << tokens.getValue(idx);
+        ++count;
+    }
+    EXPECT_EQ(count, 5u);
+
+    // the leading zeros don't count towards the overflow
+    const char *digits = "00000000000000000000000000000012345678";
+    EXPECT_EQ(WhileParser::parseNumber(digits, digits + std::strlen(digits)), 12345678);
+}
+
+// 22. Test Source That Is Not A Regular File
+TEST(LexerTest, PipeIsReadAsStream)
+{
+    // a pipe reports no size, it's not an empty program
+    const std::string filename = ::testing::TempDir() + "lexer_pipe.wh";
+    std::remove(filename.c_str());
+    ASSERT_EQ(::mkfifo(filename.c_str(), 0600), 0);
+    std::thread writer([&filename]
+                       { std::ofstream(filename) << "x := 1;"; });
+
+    WhileParser::Lexer piped(filename, true, true);
+    writer.join();
+    EXPECT_EQ(piped.nextToken().getType(), WhileParser::TokenType::IDENTIFIER);
+    EXPECT_EQ(piped.nextToken().getType(), WhileParser::TokenType::ASSIGN);
+
+    std::remove(filename.c_str());
+}
@@ -2,13 +2,57 @@
 #include <sstream>
 #include <memory>
 #include <vector>
+#include <cstdlib>
+#include <new>
+#include <random>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+#include <algorithm>
+#include <atomic>
+#include <cctype>
 
 #include "../include/Parser.hpp"
+#include "../include/FlatAST.hpp"
+#include "../include/IncrementalParser.hpp"
+#include "../include/ParallelParser.hpp"
+#include "../include/BatchParser.hpp"
+#include "../include/ParseCache.hpp"
+#include "../include/ParserPool.hpp"
+
+// Counts every heap allocation of the test binary, to compare the heap and the arena trees.
+// Atomic, since the parallel and batch parsers allocate on several threads
+static std::atomic<std::size_t> g_allocations = 0;
+
+void *operator new(std::size_t size)
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *memory = std::malloc(size ? size : 1))
+        return memory;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void *memory, std::size_t) noexcept
+{
+    std::free(memory);
+}
 
 // helpers to easily create program elements without dealing with messy pointers
+std::unique_ptr<WhileParser::ExpressionNode> terminal(const std::string &simpleExpr)
+{
+    if (!simpleExpr.empty() && std::isdigit(static_cast<unsigned char>(simpleExpr[0])))
+        return std::make_unique<WhileParser::NumberLiteralNode>(std::stoll(simpleExpr));
+    return std::make_unique<WhileParser::VariableRefNode>(simpleExpr);
+}
+
 std::unique_ptr<WhileParser::AssignmentNode> simpleAssignment(const std::string &variable, const std::string &simpleExpr)
 {
-    return std::move(std::make_unique<WhileParser::AssignmentNode>(variable, std::move(std::make_unique<WhileParser::ExpressionNode>(simpleExpr))));
+    return std::move(std::make_unique<WhileParser::AssignmentNode>(variable, terminal(simpleExpr)));
 }
 
 // it would be better to create 3/4 templatic functions that represent various types ASTNodes, namely: UnaryNodes, BinaryNodes, If/While etc.
@@ -39,8 +83,8 @@ TEST(ParserTest, MathOperatorPrecedence)
 
     correct_ast->addNode(std::make_unique<WhileParser::AssignmentNode>("x", std::make_unique<WhileParser::MathExpressionNode>(
                                                                                 "+",
-                                                                                std::make_unique<WhileParser::ExpressionNode>("10"),
-                                                                                std::make_unique<WhileParser::MathExpressionNode>("*", std::make_unique<WhileParser::ExpressionNode>("5"), std::make_unique<WhileParser::ExpressionNode>("y")))));
+                                                                                terminal("10"),
+                                                                                std::make_unique<WhileParser::MathExpressionNode>("*", terminal("5"), terminal("y")))));
 
     EXPECT_TRUE(ast_to_test->isEqual(correct_ast.get()));
 }
@@ -57,8 +101,8 @@ TEST(ParserTest, MathOperatorAssociativity)
 
     correct_ast->addNode(std::make_unique<WhileParser::AssignmentNode>("x", std::make_unique<WhileParser::MathExpressionNode>(
                                                                                 "-",
-                                                                                std::make_unique<WhileParser::MathExpressionNode>("-", std::make_unique<WhileParser::ExpressionNode>("10"), std::make_unique<WhileParser::ExpressionNode>("5")),
-                                                                                std::make_unique<WhileParser::ExpressionNode>("2"))));
+                                                                                std::make_unique<WhileParser::MathExpressionNode>("-", terminal("10"), terminal("5")),
+                                                                                terminal("2"))));
 
     EXPECT_TRUE(ast_to_test->isEqual(correct_ast.get()));
 }
@@ -75,8 +119,8 @@ TEST(ParserTest, MathExpressionsParenthesis)
 
     correct_ast->addNode(std::make_unique<WhileParser::AssignmentNode>("x", std::make_unique<WhileParser::MathExpressionNode>(
                                                                                 "*",
-                                                                                std::make_unique<WhileParser::MathExpressionNode>("+", std::make_unique<WhileParser::ExpressionNode>("2"), std::make_unique<WhileParser::ExpressionNode>("4")),
-                                                                                std::make_unique<WhileParser::ExpressionNode>("4"))));
+                                                                                std::make_unique<WhileParser::MathExpressionNode>("+", terminal("2"), terminal("3")),
+                                                                                terminal("4"))));
 
     EXPECT_TRUE(ast_to_test->isEqual(correct_ast.get()));
 }
@@ -94,7 +138,7 @@ TEST(ParserTest, BasicIf)
     correct_ast->addNode(
         std::move(simpleAssignment("x", "10")));
 
-    auto predicate = std::make_unique<WhileParser::RelationalPredicateNode>(">", (std::make_unique<WhileParser::ExpressionNode>("x")), std::make_unique<WhileParser::ExpressionNode>("10"));
+    auto predicate = std::make_unique<WhileParser::RelationalPredicateNode>(">", (terminal("x")), terminal("10"));
 
     auto then_expr = std::make_unique<WhileParser::SkipNode>();
 
@@ -118,7 +162,7 @@ TEST(ParserTest, NotPredicateIf)
     correct_ast->addNode(
         std::move(simpleAssignment("x", "10")));
 
-    auto predicate = std::make_unique<WhileParser::RelationalPredicateNode>(">", (std::make_unique<WhileParser::ExpressionNode>("x")), std::make_unique<WhileParser::ExpressionNode>("10"));
+    auto predicate = std::make_unique<WhileParser::RelationalPredicateNode>(">", (terminal("x")), terminal("10"));
 
     auto not_predicate = std::make_unique<WhileParser::NotPredicateNode>(std::move(predicate));
 
@@ -144,7 +188,7 @@ TEST(ParserTest, MixedPredicateIf)
     correct_ast->addNode(
         std::move(simpleAssignment("x", "10")));
 
-    auto math_predicate = std::make_unique<WhileParser::RelationalPredicateNode>(">", (std::make_unique<WhileParser::ExpressionNode>("x")), std::make_unique<WhileParser::ExpressionNode>("10"));
+    auto math_predicate = std::make_unique<WhileParser::RelationalPredicateNode>(">", (terminal("x")), terminal("10"));
 
     auto bool_predicate = std::make_unique<WhileParser::BooleanPredicateNode>("and", std::move(math_predicate), std::make_unique<WhileParser::PredicateNode>("true"));
 
@@ -170,11 +214,1045 @@ TEST(ParserTest, BasicWhile)
     correct_ast->addNode(
         std::move(simpleAssignment("x", "10")));
 
-    auto predicate = std::make_unique<WhileParser::RelationalPredicateNode>(">", (std::make_unique<WhileParser::ExpressionNode>("x")), std::make_unique<WhileParser::ExpressionNode>("10"));
+    auto predicate = std::make_unique<WhileParser::RelationalPredicateNode>(">", (terminal("x")), terminal("10"));
 
     auto do_expr = std::make_unique<WhileParser::SkipNode>();
 
     correct_ast->addNode(std::move(std::make_unique<WhileParser::WhileNode>(std::move(predicate), std::move(do_expr))));
 
     EXPECT_TRUE(ast_to_test->isEqual(correct_ast.get()));
-}
\ No newline at end of file
+}
+
+TEST(ParserTest, TokenStreamIsParsedManyTimes)
+{
+    const std::string code = "x := 10; while x > 10 do\n x := x - (1 + y) * 2; endwhile if not x = 1 or true then skip else skip endif";
+
+    auto expected_ast = WhileParser::Parser(std::make_unique<std::istringstream>(code)).parse();
+
+    WhileParser::Lexer lexer(WhileParser::SourceBuffer::fromString(code), true, true);
+    auto tokens = lexer.tokenizeAll();
+
+    for (int i = 0; i < 2; ++i)
+    {
+        WhileParser::Parser parser(tokens);
+        auto ast_to_test = parser.parse();
+        EXPECT_TRUE(ast_to_test->isEqual(expected_ast.get()));
+    }
+}
+
+TEST(ParserTest, ArenaTreeIsEqualToHeapTree)
+{
+    // identifiers longer than the small string buffer, so their text needs real storage
+    const std::string code = "a_very_long_variable_name := 10; while a_very_long_variable_name > 10 do\n"
+                             "another_long_variable_name := (a_very_long_variable_name + 1) * 2; endwhile "
+                             "if not true or a_very_long_variable_name = 1 then skip else skip endif";
+
+    auto heap_ast = WhileParser::Parser(std::make_unique<std::istringstream>(code)).parse();
+    auto arena_ast = WhileParser::Parser(std::make_unique<std::istringstream>(code)).parseInArena();
+
+    EXPECT_TRUE(arena_ast->isEqual(heap_ast.get()));
+    EXPECT_TRUE(heap_ast->isEqual(arena_ast.get()));
+}
+
+TEST(ParserTest, ArenaTreeAllocatesBlocksNotNodes)
+{
+    std::string code;
+    for (int i = 0; i < 2000; ++i)
+        code += "counter_of_the_loop := counter_of_the_loop + 1; if x > 10 and true then skip else y := 2 * x; endif\n";
+
+    WhileParser::Lexer lexer(WhileParser::SourceBuffer::fromString(code), true, true);
+    auto tokens = lexer.tokenizeAll();
+
+    std::size_t before = g_allocations;
+    {
+        WhileParser::Parser parser(tokens);
+        auto ast = parser.parse();
+    }
+    std::size_t heap_allocations = g_allocations - before;
+
+    before = g_allocations;
+    {
+        WhileParser::Parser parser(tokens);
+        auto ast = parser.parseInArena();
+    }
+    std::size_t arena_allocations = g_allocations - before;
+
+    // one allocation per node (and per long name) against a handful of blocks
+    EXPECT_GE(heap_allocations, 2000u * 13);
+    EXPECT_LE(arena_allocations, 20u);
+}
+
+TEST(ParserTest, ArenaParseErrorReleasesTheNodes)
+{
+    WhileParser::Parser parser(std::make_unique<std::istringstream>("x := 10; while x > 10 do x := (1 + ; endwhile"));
+    EXPECT_THROW(parser.parseInArena(), std::invalid_argument);
+}
+
+TEST(ParserTest, FlatASTRoundTrip)
+{
+    const std::string code = "x := 10; while x > 10 do\n x := x - (1 + y) * 2; endwhile if not x = 1 or true and (false) then skip else y := x; endif";
+
+    auto ast = WhileParser::Parser(std::make_unique<std::istringstream>(code)).parse();
+    auto flat = WhileParser::FlatAST::fromTree(*ast);
+
+    EXPECT_TRUE(flat.toTree()->isEqual(ast.get()));
+    EXPECT_TRUE(WhileParser::FlatAST::fromTree(*flat.toTree()).isEqual(flat));
+    // x, 10, 1, y and 2 are stored once, the true/false predicates are opcodes
+    EXPECT_EQ(flat.getTextCount(), 5u);
+
+    // a node with a missing child can't be flattened
+    WhileParser::RootNode holes;
+    holes.addNode(std::make_unique<WhileParser::IfNode>(std::make_unique<WhileParser::PredicateNode>(WhileParser::TokenType::TRUE),
+                                                        nullptr, std::make_unique<WhileParser::SkipNode>()));
+    EXPECT_THROW(WhileParser::FlatAST::fromTree(holes), std::invalid_argument);
+    WhileParser::RootNode empty_statement;
+    empty_statement.addNode(nullptr);
+    EXPECT_THROW(WhileParser::FlatAST::fromTree(empty_statement), std::invalid_argument);
+}
+
+TEST(ParserTest, FlatASTTraversal)
+{
+    auto ast = WhileParser::Parser(std::make_unique<std::istringstream>("x := 1 + y; while true do skip endwhile")).parse();
+    auto flat = WhileParser::FlatAST::fromTree(*ast);
+
+    using WhileParser::NodeKind;
+    ASSERT_EQ(flat.size(), 8u);
+    EXPECT_EQ(flat.getKind(0), NodeKind::ROOT);
+    EXPECT_EQ(flat.childCount(0), 2u);
+
+    auto assignment = flat.getChild(0, 0);
+    EXPECT_EQ(flat.getKind(assignment), NodeKind::ASSIGNMENT);
+    EXPECT_EQ(flat.getText(assignment), "x");
+
+    auto sum = flat.firstChild(assignment);
+    EXPECT_EQ(flat.getKind(sum), NodeKind::MATH_EXPRESSION);
+    EXPECT_EQ(flat.getOperator(sum), WhileParser::TokenType::PLUS);
+    EXPECT_EQ(flat.getText(flat.getChild(sum, 0)), "1");
+    EXPECT_EQ(flat.getText(flat.getChild(sum, 1)), "y");
+    EXPECT_EQ(flat.getChild(sum, 2), WhileParser::FlatAST::NO_NODE);
+
+    auto loop = flat.getChild(0, 1);
+    EXPECT_EQ(flat.getKind(loop), NodeKind::WHILE);
+    std::vector<NodeKind> kinds;
+    flat.forEachChild(loop, [&](WhileParser::FlatAST::NodeIndex child)
+                      { kinds.push_back(flat.getKind(child)); });
+    EXPECT_EQ(kinds, (std::vector<NodeKind>{NodeKind::PREDICATE, NodeKind::SKIP}));
+    EXPECT_EQ(flat.getSubtreeEnd(loop), flat.size());
+}
+
+TEST(ParserTest, FlatASTSaveAndLoad)
+{
+    namespace fs = std::filesystem;
+    std::string path = (fs::temp_directory_path() / "while_parser_flat_test.wast").string();
+
+    const std::string code = "x := 007 + y; if x < 18446744073709551616 then skip else while not false do x := x * 2; endwhile endif";
+    auto ast = WhileParser::Parser(std::make_unique<std::istringstream>(code)).parse();
+    auto flat = WhileParser::FlatAST::fromTree(*ast);
+    flat.save(path);
+
+    auto loaded = WhileParser::FlatAST::load(path);
+    EXPECT_TRUE(loaded.isMapped());
+    EXPECT_TRUE(loaded.isEqual(flat));
+    EXPECT_TRUE(loaded.toTree()->isEqual(ast.get()));
+    EXPECT_EQ(loaded.getTextCount(), flat.getTextCount());
+
+    // the number literals keep their text and have their value, if it fits 64 bits
+    auto sum = loaded.firstChild(loaded.getChild(0, 0));
+    EXPECT_EQ(loaded.getText(loaded.getChild(sum, 0)), "7");
+    EXPECT_EQ(loaded.getNumber(loaded.getChild(sum, 0)), 7u);
+    EXPECT_EQ(loaded.getNumber(loaded.getChild(sum, 1)), WhileParser::FlatAST::NO_NUMBER);
+    auto relational = loaded.firstChild(loaded.getChild(0, 1));
+    EXPECT_EQ(loaded.getNumber(loaded.getChild(relational, 1)), WhileParser::FlatAST::NO_NUMBER);
+
+    // a copy shares the mapping, and a loaded tree can be saved again byte for byte
+    WhileParser::FlatAST copy = loaded;
+    std::string again = path + ".again";
+    copy.save(again);
+    auto read = [](const std::string &file)
+    {
+        std::ifstream in(file, std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    };
+    std::string bytes = read(path);
+    EXPECT_EQ(read(again), bytes);
+
+    auto write = [&path](const std::string &text)
+    {
+        std::ofstream(path, std::ios::binary) << text;
+    };
+    write(bytes.substr(0, bytes.size() - 1));
+    EXPECT_THROW(WhileParser::FlatAST::load(path), std::invalid_argument);
+    write("x := 1; y := 2; z := 3; w := 4;");
+    EXPECT_THROW(WhileParser::FlatAST::load(path), std::invalid_argument);
+    std::string version = bytes;
+    version[8] = WhileParser::FlatAST::FORMAT_VERSION + 1;
+    write(version);
+    EXPECT_THROW(WhileParser::FlatAST::load(path), std::invalid_argument);
+    // the end of the root points past the last node
+    std::string corrupted = bytes;
+    corrupted[32 + 4] = 100;
+    write(corrupted);
+    EXPECT_THROW(WhileParser::FlatAST::load(path), std::invalid_argument);
+    // the sum says true instead of +
+    std::string tampered = bytes;
+    tampered[32 + sum * sizeof(WhileParser::FlatAST::Node) + 1] = static_cast<char>(WhileParser::TokenType::TRUE);
+    write(tampered);
+    EXPECT_THROW(WhileParser::FlatAST::load(path), std::invalid_argument);
+    EXPECT_THROW(WhileParser::FlatAST::load(path + ".missing"), std::runtime_error);
+
+    fs::remove(path);
+    fs::remove(again);
+}
+
+TEST(ParserTest, IsEqualChecksTheNumberOfStatements)
+{
+    auto shorter = WhileParser::Parser(std::make_unique<std::istringstream>("x := 1;")).parse();
+    auto longer = WhileParser::Parser(std::make_unique<std::istringstream>("x := 1; y := 2;")).parse();
+
+    EXPECT_FALSE(shorter->isEqual(longer.get()));
+    EXPECT_FALSE(longer->isEqual(shorter.get()));
+    EXPECT_TRUE(longer->isEqual(longer.get()));
+}
+
+TEST(ParserTest, IsEqualComparesKindsAndMissingNodes)
+{
+    // a math expression is an expression, but not an equal one
+    WhileParser::VariableRefNode variable("x");
+    WhileParser::MathExpressionNode math(terminal("x"));
+    EXPECT_FALSE(variable.isEqual(&math));
+    EXPECT_FALSE(math.isEqual(&variable));
+    EXPECT_FALSE(variable.isEqual(nullptr));
+
+    // the single operand form has no right side
+    WhileParser::MathExpressionNode other_math(terminal("x"));
+    EXPECT_TRUE(math.isEqual(&other_math));
+
+    EXPECT_EQ(math.getKind(), WhileParser::NodeKind::MATH_EXPRESSION);
+    EXPECT_EQ(variable.getKind(), WhileParser::NodeKind::VARIABLE_REF);
+}
+
+TEST(ParserTest, NumberLiteralsKeepTheirValue)
+{
+    using WhileParser::NodeKind;
+    auto ast = WhileParser::Parser(std::make_unique<std::istringstream>("x := 0042 + y; z := 99999999999999999999 * 3;")).parse();
+
+    auto first = static_cast<const WhileParser::AssignmentNode *>(ast->getChildren()[0].get());
+    auto sum = static_cast<const WhileParser::MathExpressionNode *>(first->getExpression());
+    ASSERT_EQ(sum->getLeftExpression()->getKind(), NodeKind::NUMBER_LITERAL);
+    auto number = static_cast<const WhileParser::NumberLiteralNode *>(sum->getLeftExpression());
+    EXPECT_EQ(number->getValue(), 42);
+    EXPECT_FALSE(number->isOverflow());
+    ASSERT_EQ(sum->getRightExpression()->getKind(), NodeKind::VARIABLE_REF);
+    EXPECT_EQ(static_cast<const WhileParser::VariableRefNode *>(sum->getRightExpression())->getName(), "y");
+
+    // a number beyond 64 bits keeps its digits, for an arbitrary precision evaluation
+    auto second = static_cast<const WhileParser::AssignmentNode *>(ast->getChildren()[1].get());
+    auto product = static_cast<const WhileParser::MathExpressionNode *>(second->getExpression());
+    auto big = static_cast<const WhileParser::NumberLiteralNode *>(product->getLeftExpression());
+    EXPECT_TRUE(big->isOverflow());
+    EXPECT_EQ(big->getDigits(), "99999999999999999999");
+    EXPECT_FALSE(big->isEqual(product->getRightExpression()));
+
+    // the literals compare by value, and survive a flat round trip
+    EXPECT_TRUE(number->isEqual(terminal("42").get()));
+    EXPECT_TRUE(WhileParser::FlatAST::fromTree(*ast).toTree()->isEqual(ast.get()));
+}
+
+TEST(ParserTest, OperatorsAreOpcodes)
+{
+    using WhileParser::TokenType;
+    auto ast = WhileParser::Parser(std::make_unique<std::istringstream>("while x <= 2 and not false do x := x / 2; endwhile")).parse();
+
+    auto loop = static_cast<const WhileParser::WhileNode *>(ast->getChildren()[0].get());
+    auto conjunction = static_cast<const WhileParser::BooleanPredicateNode *>(loop->getCondition());
+    EXPECT_EQ(conjunction->getOpcode(), TokenType::AND);
+    auto relational = static_cast<const WhileParser::RelationalPredicateNode *>(conjunction->getLeftPredicate());
+    EXPECT_EQ(relational->getOpcode(), TokenType::LTE);
+    EXPECT_EQ(relational->getOperation(), "<=");
+    auto negation = static_cast<const WhileParser::NotPredicateNode *>(conjunction->getRightPredicate());
+    EXPECT_EQ(negation->getPredicate()->getConstant(), TokenType::FALSE);
+    auto assignment = static_cast<const WhileParser::AssignmentNode *>(loop->getStatement());
+    EXPECT_EQ(static_cast<const WhileParser::MathExpressionNode *>(assignment->getExpression())->getOpcode(), TokenType::SLASH);
+
+    // the spelling constructors build the same nodes, and reject what isn't an operator
+    WhileParser::MathExpressionNode by_spelling("/", terminal("x"), terminal("2"));
+    WhileParser::MathExpressionNode by_opcode(TokenType::SLASH, terminal("x"), terminal("2"));
+    EXPECT_TRUE(by_spelling.isEqual(&by_opcode));
+    EXPECT_EQ(by_spelling.getHash(), by_opcode.getHash());
+    EXPECT_THROW(WhileParser::MathExpressionNode("%", terminal("x"), terminal("2")), std::invalid_argument);
+    EXPECT_THROW(WhileParser::PredicateNode("yes"), std::invalid_argument);
+
+    // the opcode sits in the padding of the base node: a binary node is its two children and the header
+    EXPECT_EQ(sizeof(WhileParser::MathExpressionNode), sizeof(WhileParser::SkipNode) + 2 * sizeof(void *));
+    EXPECT_EQ(sizeof(WhileParser::BooleanPredicateNode), sizeof(WhileParser::SkipNode) + 2 * sizeof(void *));
+}
+
+TEST(ParserTest, IdentifiersHaveDenseSlots)
+{
+    // v<i> is new at statement i, and its expression names a variable seen before
+    std::string code;
+    for (std::size_t i = 0; i < 12000; ++i)
+        code += "v" + std::to_string(i) + " := v" + std::to_string(i / 2) + " + 1;\n";
+
+    auto expectSlots = [](const WhileParser::RootNode &root)
+    {
+        const WhileParser::SymbolTable *symbols = root.getSymbols();
+        ASSERT_NE(symbols, nullptr);
+        ASSERT_EQ(symbols->size(), root.getChildren().size());
+        for (std::size_t i = 0; i < root.getChildren().size(); ++i)
+        {
+            auto assignment = static_cast<const WhileParser::AssignmentNode *>(root.getChildren()[i].get());
+            auto sum = static_cast<const WhileParser::MathExpressionNode *>(assignment->getExpression());
+            auto variable = static_cast<const WhileParser::VariableRefNode *>(sum->getLeftExpression());
+            ASSERT_EQ(assignment->getSlot(), i);
+            ASSERT_EQ(variable->getSlot(), i / 2);
+            ASSERT_EQ(symbols->getName(assignment->getSlot()), assignment->getVariableName());
+            ASSERT_EQ(symbols->find(variable->getName()), variable->getSlot());
+        }
+    };
+
+    auto tokens = WhileParser::Lexer(WhileParser::SourceBuffer::fromString(code), true, true).tokenizeAll();
+    std::weak_ptr<const WhileParser::SymbolTable> arena_symbols;
+    for (auto mode : {WhileParser::ParseMode::RECURSIVE_DESCENT, WhileParser::ParseMode::EXPLICIT_STACK})
+    {
+        WhileParser::Parser parser(std::make_unique<std::istringstream>(code));
+        parser.setParseMode(mode);
+        auto root = parser.parse();
+        expectSlots(*root);
+        expectSlots(*WhileParser::FlatAST::fromTree(*root).toTree());
+
+        // the pieces of a parallel parse share one table
+        WhileParser::ParallelParser parallel(tokens, 4);
+        parallel.setParseMode(mode);
+        expectSlots(*parallel.parse());
+
+        // a reset while the tree holds the table leaves it alone
+        parser.reset(tokens);
+        auto tree = parser.parseInArena(true);
+        expectSlots(*tree);
+        EXPECT_NE(tree->getSymbols(), root->getSymbols());
+        EXPECT_EQ(root->getSymbols()->getName(1), "v1");
+        arena_symbols = parser.getSymbols();
+        parser.reset(std::string_view("x := 1;"));
+    }
+    // the arena tree released its table, that the nodes in the arena couldn't
+    EXPECT_TRUE(arena_symbols.expired());
+
+    // the same identifier is the same slot, wherever it is
+    auto ast = WhileParser::Parser(std::make_unique<std::istringstream>("x := y; while x > y do y := x; endwhile")).parse();
+    auto loop = static_cast<const WhileParser::WhileNode *>(ast->getChildren()[1].get());
+    auto relational = static_cast<const WhileParser::RelationalPredicateNode *>(loop->getCondition());
+    auto inner = static_cast<const WhileParser::AssignmentNode *>(loop->getStatement());
+    EXPECT_EQ(static_cast<const WhileParser::VariableRefNode *>(relational->getLeftExpression())->getSlot(),
+              static_cast<const WhileParser::AssignmentNode *>(ast->getChildren()[0].get())->getSlot());
+    EXPECT_EQ(static_cast<const WhileParser::VariableRefNode *>(relational->getRightExpression())->getSlot(), inner->getSlot());
+    EXPECT_EQ(ast->getSymbols()->size(), 2u);
+
+    // the nodes built out of a program have no slot, and keep their own name
+    EXPECT_EQ(simpleAssignment("x", "y")->getSlot(), WhileParser::SymbolTable::NO_SLOT);
+    EXPECT_TRUE(simpleAssignment("x", "y")->isEqual(ast->getChildren()[0].get()));
+    EXPECT_EQ(WhileParser::RootNode().getSymbols(), nullptr);
+
+    // the slot sits in the padding of the base node, the name is a view
+    EXPECT_EQ(sizeof(WhileParser::VariableRefNode), sizeof(WhileParser::SkipNode) + sizeof(std::string_view) + sizeof(void *));
+}
+
+TEST(ParserTest, IsEqualStopsAtTheFirstDifference)
+{
+    std::string code;
+    for (int i = 0; i < 1000; ++i)
+        code += "x := (x + 1) * 2; while not x > 2 do skip endwhile\n";
+
+    auto left = WhileParser::Parser(std::make_unique<std::istringstream>(code)).parse();
+    auto right = WhileParser::Parser(std::make_unique<std::istringstream>(code)).parse();
+    auto changed = WhileParser::Parser(std::make_unique<std::istringstream>(code + "x := 3;")).parse();
+    auto different = WhileParser::Parser(std::make_unique<std::istringstream>("y := 1;" + code)).parse();
+
+    EXPECT_TRUE(left->isEqual(right.get()));
+    EXPECT_FALSE(left->isEqual(changed.get()));
+    EXPECT_FALSE(changed->isEqual(left.get()));
+    EXPECT_FALSE(different->isEqual(changed.get()));
+}
+
+TEST(ParserTest, StructuralHashes)
+{
+    auto ast = WhileParser::Parser(std::make_unique<std::istringstream>("x := (y + 1) * 2; z := (y + 1) * 2; z := (y + 1) * 3;")).parse();
+    auto same = WhileParser::Parser(std::make_unique<std::istringstream>("x := (y + 1) * 2; z := (y + 1) * 2; z := (y + 1) * 3;")).parse();
+    auto other = WhileParser::Parser(std::make_unique<std::istringstream>("x := (y + 1) * 2; z := (y + 1) * 2; z := (y - 1) * 3;")).parse();
+
+    EXPECT_EQ(ast->getHash(), same->getHash());
+    EXPECT_NE(ast->getHash(), other->getHash());
+
+    const auto &statements = ast->getChildren();
+    auto first = static_cast<const WhileParser::AssignmentNode *>(statements[0].get());
+    auto second = static_cast<const WhileParser::AssignmentNode *>(statements[1].get());
+    auto third = static_cast<const WhileParser::AssignmentNode *>(statements[2].get());
+
+    // same expression, different variables
+    EXPECT_EQ(first->getExpression()->getHash(), second->getExpression()->getHash());
+    EXPECT_NE(first->getHash(), second->getHash());
+    EXPECT_NE(second->getExpression()->getHash(), third->getExpression()->getHash());
+}
+
+TEST(ParserTest, HashConsingSharesSubtrees)
+{
+    std::string code;
+    for (int i = 0; i < 2000; ++i)
+        code += "counter := (counter + 1) * 2; if counter > 10 and not done = 1 then skip else counter := (counter + 1) * 2; endif\n";
+
+    WhileParser::Lexer lexer(WhileParser::SourceBuffer::fromString(code), true, true);
+    auto tokens = lexer.tokenizeAll();
+
+    auto heap_ast = WhileParser::Parser(tokens).parse();
+    auto tree = WhileParser::Parser(tokens).parseInArena();
+    auto dag = WhileParser::Parser(tokens).parseInArena(true);
+
+    EXPECT_TRUE(dag->isEqual(heap_ast.get()));
+    EXPECT_TRUE(heap_ast->isEqual(dag.get()));
+    EXPECT_TRUE(dag->isEqual(tree.get()));
+    EXPECT_EQ(dag->getHash(), heap_ast->getHash());
+
+    // the expressions of all the assignments are a single node
+    const auto &statements = dag->getChildren();
+    auto first = static_cast<const WhileParser::AssignmentNode *>(statements[0].get());
+    auto last = static_cast<const WhileParser::AssignmentNode *>(statements[statements.size() - 2].get());
+    EXPECT_EQ(first->getExpression(), last->getExpression());
+
+    EXPECT_LT(dag.getArena().getReservedBytes() * 4, tree.getArena().getReservedBytes());
+}
+
+TEST(ParserTest, HashConsingParseError)
+{
+    WhileParser::Parser parser(std::make_unique<std::istringstream>("x := y + 1; z := y + 1; while y + 1 > 2 do x := (y + 1 ; endwhile"));
+    EXPECT_THROW(parser.parseInArena(true), std::invalid_argument);
+}
+
+std::unique_ptr<WhileParser::RootNode> parseWithStack(const std::string &code)
+{
+    WhileParser::Parser parser(std::make_unique<std::istringstream>(code));
+    parser.setParseMode(WhileParser::ParseMode::EXPLICIT_STACK);
+    return parser.parse();
+}
+
+std::string repeat(const std::string &text, std::size_t times)
+{
+    std::string repeated;
+    repeated.reserve(text.size() * times);
+    for (std::size_t i = 0; i < times; ++i)
+        repeated += text;
+    return repeated;
+}
+
+// discards what is written on it, counting the characters
+class CountingBuffer : public std::streambuf
+{
+public:
+    std::size_t written = 0;
+
+protected:
+    std::streamsize xsputn(const char *, std::streamsize count) override
+    {
+        written += count;
+        return count;
+    }
+
+    int_type overflow(int_type c) override
+    {
+        ++written;
+        return traits_type::not_eof(c);
+    }
+};
+
+TEST(ParserTest, ExplicitStackBuildsTheSameTrees)
+{
+    const std::vector<std::string> programs = {
+        "x := 1;",
+        "x := (1 + y) * 2 - z / 3; if not (x > 1 and true) or false then skip else while x <= 2 do x := x; endwhile endif",
+        "while not not (x = 1 or y < 2 and z >= 3) do if true then y := ((y)); else skip endif endwhile x := a - b - c * d / e;",
+    };
+    for (const auto &code : programs)
+    {
+        auto expected = WhileParser::Parser(std::make_unique<std::istringstream>(code)).parse();
+        auto ast = parseWithStack(code);
+        EXPECT_TRUE(ast->isEqual(expected.get())) << code;
+
+        WhileParser::Parser parser(std::make_unique<std::istringstream>(code));
+        parser.setParseMode(WhileParser::ParseMode::EXPLICIT_STACK);
+        auto dag = parser.parseInArena(true);
+        EXPECT_TRUE(dag->isEqual(expected.get())) << code;
+    }
+
+    // and fails in the same way
+    const std::vector<std::string> errors = {
+        "x := 1",
+        "x := (1 + 2;",
+        "if x then skip else skip endif",
+        "while (x > 1 do skip endwhile",
+        "if true then skip endif",
+        "x := * 2;",
+        ":= 2;",
+    };
+    for (const auto &code : errors)
+    {
+        std::string expected;
+        try
+        {
+            WhileParser::Parser(std::make_unique<std::istringstream>(code)).parse();
+        }
+        catch (const std::invalid_argument &exception)
+        {
+            expected = exception.what();
+        }
+        ASSERT_FALSE(expected.empty()) << code;
+
+        try
+        {
+            parseWithStack(code);
+            ADD_FAILURE() << code;
+        }
+        catch (const std::invalid_argument &exception)
+        {
+            EXPECT_EQ(exception.what(), expected) << code;
+        }
+    }
+}
+
+TEST(ParserTest, ExplicitStackParsesDeepNesting)
+{
+    const std::size_t depth = 1000000;
+
+    auto whiles = parseWithStack(repeat("while true do ", depth) + "skip" + repeat(" endwhile", depth));
+    const WhileParser::ASTNode *node = whiles->getChildren()[0].get();
+    std::size_t count = 0;
+    for (; node->getKind() == WhileParser::NodeKind::WHILE; ++count)
+        node = static_cast<const WhileParser::WhileNode *>(node)->getStatement();
+    EXPECT_EQ(count, depth);
+    EXPECT_EQ(node->getKind(), WhileParser::NodeKind::SKIP);
+
+    auto nots = parseWithStack("if " + repeat("not ", depth) + "true then skip else skip endif");
+    node = static_cast<const WhileParser::IfNode *>(nots->getChildren()[0].get())->getCondition();
+    for (count = 0; node->getKind() == WhileParser::NodeKind::NOT_PREDICATE; ++count)
+        node = static_cast<const WhileParser::NotPredicateNode *>(node)->getPredicate();
+    EXPECT_EQ(count, depth);
+    EXPECT_EQ(static_cast<const WhileParser::PredicateNode *>(node)->getTerminalPredicate(), "true");
+
+    // parentheses don't make nodes, but they nest the productions just the same
+    auto parentheses = parseWithStack("while " + repeat("(", depth) + "true" + repeat(")", depth) + " do skip endwhile");
+    auto loop = static_cast<const WhileParser::WhileNode *>(parentheses->getChildren()[0].get());
+    EXPECT_EQ(loop->getCondition()->getKind(), WhileParser::NodeKind::PREDICATE);
+
+    auto right_deep = parseWithStack("x := " + repeat("1 - (", depth) + "1" + repeat(")", depth) + ";");
+    node = static_cast<const WhileParser::AssignmentNode *>(right_deep->getChildren()[0].get())->getExpression();
+    for (count = 0; node->getKind() == WhileParser::NodeKind::MATH_EXPRESSION; ++count)
+        node = static_cast<const WhileParser::MathExpressionNode *>(node)->getRightExpression();
+    EXPECT_EQ(count, depth);
+}
+
+TEST(ParserTest, DeepTreesArePrintedComparedAndDestroyed)
+{
+    const std::size_t depth = 1000000;
+    const std::string nots = repeat("not ", depth);
+
+    auto ast = parseWithStack("if " + nots + "true then skip else skip endif");
+    auto same = parseWithStack("if " + nots + "true then skip else skip endif");
+    auto different = parseWithStack("if " + nots + "false then skip else skip endif");
+    EXPECT_TRUE(ast->isEqual(same.get()));
+    EXPECT_FALSE(ast->isEqual(different.get()));
+
+    // a line is its indentation (4 characters a level), its text and the newline
+    auto line = [](std::size_t indent, std::size_t text)
+    { return indent * 4 + text + 1; };
+    std::size_t expected = line(0, 8) + line(1, 6) + line(2, 9);
+    for (std::size_t level = 0; level < depth; ++level)
+        expected += line(3 + level, 16);
+    expected += line(3 + depth, 13) + line(5 + depth, 4);
+    expected += line(2, 10) + line(3, 8) + line(2, 10) + line(3, 8);
+
+    CountingBuffer buffer;
+    std::ostream out(&buffer);
+    ast->printNode(out);
+    EXPECT_EQ(buffer.written, expected);
+
+    // the recursive descent builds left-deep chains with a loop, and they have to be destroyed too
+    auto chain = WhileParser::Parser(std::make_unique<std::istringstream>("x := 1" + repeat(" + 1", depth) + ";")).parse();
+    EXPECT_EQ(chain->getChildren().size(), 1);
+    chain.reset();
+    ast.reset();
+}
+
+TEST(ParserTest, DiagnosticsCollectAllTheErrors)
+{
+    const std::string code = "x := 1;\n"
+                             "y := ;\n"
+                             "while x > do skip endwhile\n"
+                             "if x < 2 then z := 2 else skip endif\n"
+                             "w := 3 $ 4;\n"
+                             "endwhile\n"
+                             "while true do if x then skip else skip endif endwhile\n"
+                             "v := (1 + 2;\n"
+                             "u := 5;";
+    const std::vector<std::string> expected = {
+        "The EXPRESSION is malformed: expected IDENTIFIER/NUMBER, got SEMICOLON",
+        "The EXPRESSION is malformed: expected IDENTIFIER/NUMBER, got DO",
+        "Expected SEMICOLON Got: ELSE",
+        "The following token is unknown: $",
+        "Expected SEMICOLON Got: NUMBER",
+        "The syntax is not correct",
+        "Expected relational operator after expression, got: then",
+        "Expected RPAREN Got: SEMICOLON",
+    };
+
+    for (auto mode : {WhileParser::ParseMode::RECURSIVE_DESCENT, WhileParser::ParseMode::EXPLICIT_STACK})
+    {
+        WhileParser::Parser parser(std::make_unique<std::istringstream>(code));
+        parser.setParseMode(mode);
+        auto result = parser.parseWithDiagnostics();
+
+        EXPECT_FALSE(result.ok());
+        EXPECT_EQ(result.root, nullptr);
+        ASSERT_EQ(result.diagnostics.size(), expected.size());
+        for (std::size_t i = 0; i < expected.size(); ++i)
+            EXPECT_EQ(result.diagnostics[i].message, expected[i]);
+
+        // the ; of y := ; and the $
+        EXPECT_EQ(result.diagnostics[0].offset, code.find(';', 8));
+        EXPECT_EQ(result.diagnostics[3].offset, code.find('$'));
+
+        // an error in a branch doesn't hide the ones after it, in the same if or after it
+        parser.reset(std::string_view("if true then x := ; else while x > 1 do y := ; endwhile endif z := ;"));
+        EXPECT_EQ(parser.parseWithDiagnostics().diagnostics.size(), 3u);
+    }
+}
+
+TEST(ParserTest, DiagnosticsOfAValidProgram)
+{
+    const std::string code = "x := (1 + y) * 2; if not x > 1 then skip else while x <= 2 do x := x - 1; endwhile endif";
+    auto expected = WhileParser::Parser(std::make_unique<std::istringstream>(code)).parse();
+
+    WhileParser::Parser parser(std::make_unique<std::istringstream>(code));
+    auto result = parser.parseWithDiagnostics();
+    EXPECT_TRUE(result.ok());
+    ASSERT_NE(result.root, nullptr);
+    EXPECT_TRUE(result.root->isEqual(expected.get()));
+
+    // an unknown first token is reported too, and not thrown by the constructor
+    WhileParser::Parser unknown(std::make_unique<std::istringstream>("$ x := 1;"));
+    EXPECT_EQ(unknown.parseWithDiagnostics().diagnostics.size(), 1);
+}
+
+// the statements with errors are null children of the root, and only of the root
+void expectNoNestedHoles(const WhileParser::RootNode &root)
+{
+    std::vector<const WhileParser::StatementNode *> stack;
+    for (const auto &child : root.getChildren())
+        if (child)
+            stack.push_back(static_cast<const WhileParser::StatementNode *>(child.get()));
+    while (!stack.empty())
+    {
+        const WhileParser::StatementNode *statement = stack.back();
+        stack.pop_back();
+        ASSERT_NE(statement, nullptr);
+        if (statement->getKind() == WhileParser::NodeKind::IF)
+        {
+            auto if_node = static_cast<const WhileParser::IfNode *>(statement);
+            stack.push_back(if_node->getThenBranch());
+            stack.push_back(if_node->getElseBranch());
+        }
+        else if (statement->getKind() == WhileParser::NodeKind::WHILE)
+            stack.push_back(static_cast<const WhileParser::WhileNode *>(statement)->getStatement());
+    }
+}
+
+// the tree and the errors of a full parse of the current source
+void expectSameAsFullParse(const WhileParser::IncrementalParser &incremental)
+{
+    expectNoNestedHoles(incremental.getTree());
+    WhileParser::IncrementalParser full{std::string(incremental.getSource())};
+    EXPECT_TRUE(incremental.getTree().isEqual(&full.getTree())) << incremental.getSource();
+    ASSERT_EQ(incremental.getDiagnostics().size(), full.getDiagnostics().size()) << incremental.getSource();
+    for (std::size_t i = 0; i < full.getDiagnostics().size(); ++i)
+    {
+        EXPECT_EQ(incremental.getDiagnostics()[i].message, full.getDiagnostics()[i].message);
+        EXPECT_EQ(incremental.getDiagnostics()[i].offset, full.getDiagnostics()[i].offset);
+    }
+}
+
+TEST(ParserTest, IncrementalParseMatchesAFullParse)
+{
+    const std::string code = "x := 1;\n"
+                             "while x < 10 do if x = 2 then y := x * 2; else skip endif endwhile\n"
+                             "z := (x + y) / 2;\n";
+    WhileParser::IncrementalParser incremental(code);
+    EXPECT_TRUE(incremental.ok());
+    EXPECT_TRUE(incremental.getTree().isEqual(WhileParser::Parser(std::make_unique<std::istringstream>(code)).parse().get()));
+
+    auto edit = [&incremental](std::size_t offset, std::size_t removed, const std::string &inserted)
+    {
+        incremental.edit(offset, removed, inserted);
+        expectSameAsFullParse(incremental);
+    };
+
+    edit(5, 1, "42");                                            // in a statement
+    edit(0, 0, "skip ");                                         // a new first statement
+    edit(incremental.getSource().find("skip endif"), 4, "w :=");  // an error in a nested statement
+    EXPECT_FALSE(incremental.ok());
+    edit(incremental.getSource().find("w :="), 4, "skip");       // and its fix
+    EXPECT_TRUE(incremental.ok());
+    edit(incremental.getSource().find("skip"), 4, "skipx");      // a token glued to the next one
+    edit(incremental.getSource().find("endwhile"), 0, "$");      // unknown token
+    edit(incremental.getSource().find("z :="), 0, "while true do ");
+    edit(incremental.getSource().size(), 0, " endwhile");        // the while opened above swallows z
+    edit(0, incremental.getSource().size(), "");                 // everything removed
+    EXPECT_EQ(incremental.getTree().getChildren().size(), 0);
+
+    // random edits, with the pieces of the grammar and some noise
+    const char *pieces[] = {"", " ", "\n", "x", "1", ";", ":=", "+", "*", "(", ")", "<", "$", "skip ", "if ", "then ",
+                            "else ", "endif ", "while ", "do ", "endwhile ", "true", "not ", "and "};
+    std::mt19937 random(7);
+    edit(0, 0, code);
+    for (int i = 0; i < 300; ++i)
+    {
+        std::size_t offset = random() % (incremental.getSource().size() + 1);
+        std::size_t removed = std::min<std::size_t>(random() % 4, incremental.getSource().size() - offset);
+        edit(offset, removed, pieces[random() % (sizeof(pieces) / sizeof(pieces[0]))]);
+    }
+
+    EXPECT_THROW(incremental.edit(incremental.getSource().size(), 1, "x"), std::invalid_argument);
+}
+
+TEST(ParserTest, IncrementalParseLeavesOutStatementsWithErrors)
+{
+    // an error in a nested statement leaves out the whole top level statement, not only the nested one
+    for (const std::string code : {"if true then x := ; else skip endif", "while true do x := ; endwhile",
+                                   "if true then skip else while x > 0 do y := ; endwhile endif"})
+    {
+        WhileParser::IncrementalParser incremental(code);
+        EXPECT_FALSE(incremental.ok());
+        ASSERT_EQ(incremental.getTree().getChildren().size(), 1u);
+        EXPECT_EQ(incremental.getTree().getChildren()[0], nullptr) << code;
+        expectSameAsFullParse(incremental);
+
+        // fixed, the tree is complete again
+        incremental.edit(incremental.getSource().find(":= ;"), 4, ":= 1;");
+        EXPECT_TRUE(incremental.ok());
+        expectSameAsFullParse(incremental);
+        EXPECT_TRUE(WhileParser::FlatAST::fromTree(incremental.getTree()).toTree()->isEqual(&incremental.getTree()));
+    }
+
+    // a tree with holes is not flattened
+    WhileParser::IncrementalParser incremental("x := 1; y := ; z := 2;");
+    ASSERT_EQ(incremental.getTree().getChildren().size(), 3u);
+    EXPECT_EQ(incremental.getTree().getChildren()[1], nullptr);
+    EXPECT_THROW(WhileParser::FlatAST::fromTree(incremental.getTree()), std::invalid_argument);
+}
+
+TEST(ParserTest, IncrementalParseReusesStatements)
+{
+    const std::string statement = "x := x + 1;\n";
+    WhileParser::IncrementalParser incremental(repeat(statement, 1000));
+    std::vector<const WhileParser::ASTNode *> before;
+    for (const auto &child : incremental.getTree().getChildren())
+        before.push_back(child.get());
+
+    // a one character edit reparses that statement only
+    incremental.edit(500 * statement.size() + 9, 1, "7");
+    expectSameAsFullParse(incremental);
+    EXPECT_LE(incremental.getReparsedBytes(), statement.size());
+    ASSERT_EQ(incremental.getTree().getChildren().size(), before.size());
+    for (std::size_t i = 0; i < before.size(); ++i)
+        EXPECT_EQ(incremental.getTree().getChildren()[i].get() == before[i], i != 500) << i;
+
+    // the nested statements out of the edit are moved in the new tree
+    const std::string nested = "while x > 0 do if x < 1 then if y < 1 then x := 1; else y := 2; endif else " + repeat("while y > 0 do ", 100) +
+                               "skip" + repeat(" endwhile", 100) + " endif endwhile";
+    WhileParser::IncrementalParser deep(nested);
+    auto *body = static_cast<const WhileParser::IfNode *>(static_cast<const WhileParser::WhileNode *>(deep.getTree().getChildren()[0].get())->getStatement());
+    const WhileParser::StatementNode *else_branch = body->getElseBranch();
+    const WhileParser::StatementNode *inner_else = static_cast<const WhileParser::IfNode *>(body->getThenBranch())->getElseBranch();
+
+    deep.edit(nested.find("x := 1") + 5, 1, "5");
+    expectSameAsFullParse(deep);
+    body = static_cast<const WhileParser::IfNode *>(static_cast<const WhileParser::WhileNode *>(deep.getTree().getChildren()[0].get())->getStatement());
+    EXPECT_EQ(body->getElseBranch(), else_branch);
+    EXPECT_EQ(static_cast<const WhileParser::IfNode *>(body->getThenBranch())->getElseBranch(), inner_else);
+    EXPECT_LT(deep.getReparsedBytes(), 100);
+}
+
+TEST(ParserTest, ParallelParsingMatchesSequential)
+{
+    const std::string code = repeat("x := (1 + y) * 2;\nif not x > 1 then skip else while x <= 2 do x := x - 1; endwhile endif\n"
+                                    "while x < 3 do if x = 1 then y := 2; else skip endif endwhile skip\n",
+                                    1000);
+    std::shared_ptr<const WhileParser::SourceBuffer> source = WhileParser::SourceBuffer::fromString(code);
+    auto expected = WhileParser::Parser(std::make_unique<std::istringstream>(code)).parse();
+
+    // with the newlines in the stream too, that the parser skips
+    for (bool skip_eol : {true, false})
+    {
+        auto tokens = WhileParser::Lexer(source, true, skip_eol).tokenizeAll();
+        for (unsigned threads : {1u, 2u, 4u, 7u})
+        {
+            WhileParser::ParallelParser parser(tokens, threads);
+            auto points = parser.splitPoints();
+            EXPECT_EQ(points.size(), std::min<std::size_t>(threads, (tokens.size() - 1) / WhileParser::ParallelParser::MIN_PIECE_TOKENS) + 1);
+            EXPECT_EQ(points.back(), tokens.size() - 1);
+            EXPECT_TRUE(parser.parse()->isEqual(expected.get())) << threads;
+
+            parser.setParseMode(WhileParser::ParseMode::EXPLICIT_STACK);
+            EXPECT_TRUE(parser.parse()->isEqual(expected.get())) << threads;
+        }
+    }
+}
+
+TEST(ParserTest, ParallelParsingThrowsTheFirstError)
+{
+    // errors in two pieces: the one of the first is thrown, as parse() does
+    const std::string valid = repeat("x := 1 + 2;\nwhile x > 0 do x := x - 1; endwhile\n", 4000);
+    const std::string code = valid + "if x then skip endif\n" + valid + "y := ;\n" + valid;
+    auto tokens = WhileParser::Lexer(WhileParser::SourceBuffer::fromString(code), true, true).tokenizeAll();
+
+    std::string expected;
+    try
+    {
+        WhileParser::Parser(tokens).parse();
+    }
+    catch (const std::invalid_argument &exception)
+    {
+        expected = exception.what();
+    }
+    ASSERT_FALSE(expected.empty());
+
+    WhileParser::ParallelParser parser(tokens, 4);
+    ASSERT_EQ(parser.splitPoints().size(), 5);
+    try
+    {
+        parser.parse();
+        FAIL() << "no error thrown";
+    }
+    catch (const std::invalid_argument &exception)
+    {
+        EXPECT_EQ(exception.what(), expected);
+    }
+
+    // a stream with only the end of file
+    auto end_of_file = WhileParser::Lexer(WhileParser::SourceBuffer::fromString(""), true, true).tokenizeAll();
+    EXPECT_EQ(WhileParser::ParallelParser(end_of_file, 4).parse()->getChildren().size(), 0);
+}
+
+TEST(ParserTest, BatchParsesEveryFile)
+{
+    namespace fs = std::filesystem;
+    fs::path directory = fs::temp_directory_path() / "while_parser_batch_test";
+    fs::remove_all(directory);
+    fs::create_directories(directory / "nested");
+
+    auto write = [](const fs::path &path, const std::string &text)
+    {
+        std::ofstream(path) << text;
+    };
+    write(directory / "a.wh", "x := 1;");
+    write(directory / "nested" / "b.wh", repeat("while x < 3 do x := x + 1; endwhile\n", 5000));
+    write(directory / "nested" / "c.wh", "y := ; z := 2 $ 3;");
+    write(directory / "notes.txt", (directory / "a.wh").string() + "\n" + (directory / "missing.wh").string() + "\n");
+
+    // a directory gives its .wh files, sorted; another file is a list of paths
+    auto files = WhileParser::BatchParser::collectFiles(directory.string());
+    ASSERT_EQ(files.size(), 3);
+    EXPECT_EQ(files[0], (directory / "a.wh").string());
+    EXPECT_EQ(files[2], (directory / "nested" / "c.wh").string());
+    auto listed = WhileParser::BatchParser::collectFiles((directory / "notes.txt").string());
+    files.insert(files.end(), listed.begin(), listed.end());
+
+    for (unsigned threads : {1u, 3u, 8u})
+    {
+        auto results = WhileParser::BatchParser(threads).parseFiles(files);
+        ASSERT_EQ(results.size(), 5);
+        for (std::size_t i = 0; i < files.size(); ++i)
+            EXPECT_EQ(results[i].path, files[i]);
+
+        EXPECT_TRUE(results[0].ok);
+        EXPECT_TRUE(results[1].ok);
+        EXPECT_FALSE(results[2].ok);
+        EXPECT_EQ(results[2].errors, 3);
+        EXPECT_TRUE(results[3].ok);
+        EXPECT_FALSE(results[4].ok);
+        EXPECT_EQ(results[4].message, "Impossible to open the file");
+        EXPECT_EQ(results[1].bytes, fs::file_size(directory / "nested" / "b.wh"));
+    }
+
+    fs::remove_all(directory);
+}
+
+TEST(ParserTest, ParseEachStreamsTheStatements)
+{
+    const std::string code = "x := (1 + y) * 2; if not x > 1 then skip else while x <= 2 do x := x - 1; endwhile endif skip";
+    auto expected = WhileParser::Parser(std::make_unique<std::istringstream>(code)).parse();
+
+    for (auto mode : {WhileParser::ParseMode::RECURSIVE_DESCENT, WhileParser::ParseMode::EXPLICIT_STACK})
+    {
+        WhileParser::Parser parser(std::make_unique<std::istringstream>(code));
+        parser.setParseMode(mode);
+        std::size_t idx = 0;
+        std::size_t count = parser.parseEach([&expected, &idx](const WhileParser::StatementNode &statement)
+                                             { EXPECT_TRUE(statement.isEqual(expected->getChildren()[idx++].get())); });
+        EXPECT_EQ(count, 3);
+        EXPECT_EQ(idx, 3);
+    }
+
+    // the statements before an error are handed over before it's found
+    WhileParser::Parser parser(std::make_unique<std::istringstream>("x := 1; y := 2; z := ;"));
+    std::size_t seen = 0;
+    EXPECT_THROW(parser.parseEach([&seen](const WhileParser::StatementNode &)
+                                  { ++seen; }),
+                 std::invalid_argument);
+    EXPECT_EQ(seen, 2);
+}
+
+TEST(ParserTest, ParseCacheSkipsUnchangedFiles)
+{
+    namespace fs = std::filesystem;
+    fs::path directory = fs::temp_directory_path() / "while_parser_cache_test";
+    fs::remove_all(directory);
+    fs::create_directories(directory);
+    std::string program = (directory / "program.wh").string();
+    std::string wrong = (directory / "wrong.wh").string();
+    std::ofstream(program) << "x := 10; while x > 0 do x := x - 1; endwhile";
+    std::ofstream(wrong) << "x := ;";
+
+    WhileParser::ParseCache cache((directory / "cache").string());
+    auto parsed = cache.parse(program);
+    auto expected = WhileParser::Parser(program).parse();
+    EXPECT_TRUE(parsed->isEqual(expected.get()));
+    EXPECT_EQ(cache.getMisses(), 1u);
+
+    // the same bytes give the same entry, whatever the file
+    EXPECT_TRUE(cache.parse(program)->isEqual(expected.get()));
+    auto flat = cache.parseFlat(program);
+    EXPECT_TRUE(flat.isMapped());
+    EXPECT_TRUE(flat.toTree()->isEqual(expected.get()));
+    EXPECT_EQ(cache.getHits(), 2u);
+
+    // a changed file and a corrupted entry are parsed again
+    std::ofstream(program) << "x := 11; while x > 0 do x := x - 1; endwhile";
+    EXPECT_FALSE(cache.parse(program)->isEqual(expected.get()));
+    std::string key = WhileParser::ParseCache::keyOf("x := 11; while x > 0 do x := x - 1; endwhile");
+    std::ofstream((directory / "cache" / key).string()) << "garbage";
+    EXPECT_EQ(cache.parse(program)->getChildren().size(), 2u);
+    EXPECT_EQ(cache.getMisses(), 3u);
+    EXPECT_TRUE(cache.find(key).has_value());
+
+    // an empty file, whose mapping has no data, is a valid program
+    std::string empty = (directory / "empty.wh").string();
+    std::ofstream(empty).close();
+    EXPECT_EQ(cache.parse(empty)->getChildren().size(), 0u);
+    EXPECT_EQ(cache.parse(empty)->getChildren().size(), 0u);
+    EXPECT_EQ(WhileParser::ParseCache::keyOf(""), WhileParser::ParseCache::keyOf(std::string_view()));
+
+    // programs with errors are not stored
+    EXPECT_THROW(cache.parse(wrong), std::invalid_argument);
+    EXPECT_THROW(cache.parse(wrong), std::invalid_argument);
+    EXPECT_THROW(cache.parse(program + ".txt"), std::invalid_argument);
+
+    // the batch driver passes the cached files without parsing them
+    WhileParser::BatchParser batch(2);
+    batch.setCache(&cache);
+    auto results = batch.parseFiles({program, wrong});
+    EXPECT_TRUE(results[0].ok && results[0].cached);
+    EXPECT_FALSE(results[1].ok || results[1].cached);
+
+    // a small cache keeps only the most recent entries
+    WhileParser::ParseCache small((directory / "small").string(), 4096);
+    for (int i = 0; i < 40; ++i)
+    {
+        std::ofstream(program) << "x := " << i << "; " << repeat("y := x + 1;", 10);
+        small.parse(program);
+    }
+    std::uintmax_t total = 0;
+    for (const auto &entry : fs::directory_iterator(directory / "small"))
+        total += entry.file_size();
+    EXPECT_LE(total, 4096u);
+    EXPECT_TRUE(small.find(WhileParser::ParseCache::keyOf("x := 39; " + repeat("y := x + 1;", 10))).has_value());
+    EXPECT_FALSE(small.find(WhileParser::ParseCache::keyOf("x := 0; " + repeat("y := x + 1;", 10))).has_value());
+
+    fs::remove_all(directory);
+}
+
+TEST(ParserTest, ResetParsesAnotherProgram)
+{
+    const std::string first = "x := 10; while x > 0 do x := x - 1; endwhile";
+    const std::string second = "if not (y = 2) then y := y * 3; else skip endif";
+    auto expectedFirst = WhileParser::Parser(std::make_unique<std::istringstream>(first)).parse();
+    auto expectedSecond = WhileParser::Parser(std::make_unique<std::istringstream>(second)).parse();
+
+    for (auto mode : {WhileParser::ParseMode::RECURSIVE_DESCENT, WhileParser::ParseMode::EXPLICIT_STACK})
+    {
+        WhileParser::Parser parser(std::make_unique<std::istringstream>(first));
+        parser.setParseMode(mode);
+        EXPECT_TRUE(parser.parse()->isEqual(expectedFirst.get()));
+
+        // every kind of source, also after a parse that threw halfway
+        parser.reset(std::make_unique<std::istringstream>(second));
+        EXPECT_TRUE(parser.parse()->isEqual(expectedSecond.get()));
+        parser.reset(std::string_view("x := (1 + ; y := 2;"));
+        EXPECT_THROW(parser.parse(), std::invalid_argument);
+        parser.reset(std::string_view(first));
+        EXPECT_TRUE(parser.parse()->isEqual(expectedFirst.get()));
+        auto tokens = WhileParser::Lexer(WhileParser::SourceBuffer::fromString(second), true, true).tokenizeAll();
+        parser.reset(tokens);
+        EXPECT_TRUE(parser.parse()->isEqual(expectedSecond.get()));
+        parser.reset(std::string_view("x := ; y := ;"));
+        EXPECT_EQ(parser.parseWithDiagnostics().diagnostics.size(), 2u);
+        parser.reset(WhileParser::SourceBuffer::fromString(first));
+        EXPECT_TRUE(parser.parseInArena(true)->isEqual(expectedFirst.get()));
+
+        // the moved parser goes on where the other one was
+        parser.reset(std::string_view(second));
+        WhileParser::Parser moved(std::move(parser));
+        EXPECT_EQ(moved.getParseMode(), mode);
+        EXPECT_TRUE(moved.parse()->isEqual(expectedSecond.get()));
+    }
+
+    // once warm, a parser resets on a small program without allocating anything but the tree:
+    // the root and its children, the assignment and its expression
+    WhileParser::Parser parser(std::make_unique<std::istringstream>(first));
+    parser.parse();
+    std::size_t before = g_allocations;
+    parser.reset(std::string_view("x := 1;"));
+    auto root = parser.parse();
+    EXPECT_EQ(g_allocations - before, 4u);
+}
+
+TEST(ParserTest, ParserPoolSharesParsersAcrossThreads)
+{
+    WhileParser::ParserPool pool;
+    std::vector<std::string> programs;
+    for (int i = 0; i < 200; ++i)
+        programs.push_back("x := " + std::to_string(i) + "; while x > " + std::to_string(i % 7) + " do x := x - 1; endwhile");
+
+    std::vector<char> ok(programs.size(), false);
+    std::vector<std::thread> threads;
+    for (std::size_t t = 0; t < 4; ++t)
+        threads.emplace_back([&, t]
+                             {
+                                 for (std::size_t i = t; i < programs.size(); i += 4)
+                                 {
+                                     auto parser = pool.acquire();
+                                     parser->reset(std::string_view(programs[i]));
+                                     auto expected = WhileParser::Parser(std::make_unique<std::istringstream>(programs[i])).parse();
+                                     ok[i] = parser->parse()->isEqual(expected.get());
+                                 } });
+    for (auto &thread : threads)
+        thread.join();
+
+    EXPECT_EQ(std::count(ok.begin(), ok.end(), true), 200);
+    EXPECT_GE(pool.idle(), 1u);
+    EXPECT_LE(pool.idle(), 4u);
+
+    // a lease gives back the parser it took
+    std::size_t idle = pool.idle();
+    {
+        auto parser = pool.acquire();
+        EXPECT_EQ(pool.idle(), idle - 1);
+    }
+    EXPECT_EQ(pool.idle(), idle);
+}